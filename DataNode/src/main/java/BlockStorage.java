@@ -3,7 +3,11 @@ import java.io.FileOutputStream;
 import java.io.FileInputStream;
 import java.io.IOException;
 import java.nio.file.Files;
+import java.nio.file.Path;
 import java.nio.file.Paths;
+import java.util.List;
+import java.util.stream.Collectors;
+import java.util.stream.Stream;
 
 public class BlockStorage {
     private final String storageDir;
@@ -53,4 +57,14 @@ public class BlockStorage {
         File f = new File(storageDir, blockId);
         return f.delete();
     }
+
+    // Block ids almacenados (ruta relativa: los ids pueden contener '/')
+    public synchronized List<String> listBlocks() throws IOException {
+        Path root = Paths.get(storageDir);
+        try (Stream<Path> files = Files.walk(root)) {
+            return files.filter(Files::isRegularFile)
+                    .map(p -> root.relativize(p).toString().replace(File.separatorChar, '/'))
+                    .collect(Collectors.toList());
+        }
+    }
 }
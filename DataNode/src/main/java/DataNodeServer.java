@@ -18,8 +18,11 @@ import griddfs.RegisterDataNodeRequest;
 import griddfs.RegisterDataNodeResponse;
 import griddfs.HeartbeatRequest;
 import griddfs.HeartbeatResponse;
+import griddfs.BlockReportRequest;
+import griddfs.BlockReportResponse;
 
 import java.io.IOException;
+import java.util.List;
 import java.util.Timer;
 import java.util.TimerTask;
 import java.util.concurrent.TimeUnit;
@@ -38,6 +41,9 @@ public class DataNodeServer {
     private volatile boolean registered = false;
     private Timer heartbeatTimer;
 
+    // Block ids por BlockReport (los reportes grandes se envían en varios)
+    private static final int BLOCK_REPORT_BATCH = 10000;
+
     public DataNodeServer(int port, String storageDir, String datanodeId,
                           String namenodeHost, int namenodePort) throws IOException {
         this.port = port;
@@ -107,6 +113,9 @@ public class DataNodeServer {
                     if (resp.getSuccess()) {
                         registered = true;
                         System.out.println("✓ Registro exitoso en NameNode");
+                        // El NameNode puede no conservar las réplicas entre
+                        // reinicios: tras cada registro se reportan todas
+                        sendBlockReport();
                         return;
                     } else {
                         System.err.println("✗ Registro rechazado por NameNode");
@@ -135,6 +144,26 @@ public class DataNodeServer {
         }).start();
     }
 
+    private void sendBlockReport() {
+        try {
+            List<String> blocks = storage.listBlocks();
+            for (int i = 0; i < blocks.size(); i += BLOCK_REPORT_BATCH) {
+                BlockReportRequest req = BlockReportRequest.newBuilder()
+                        .setDatanodeId(datanodeId)
+                        .addAllBlockIds(blocks.subList(i, Math.min(i + BLOCK_REPORT_BATCH, blocks.size())))
+                        .build();
+                BlockReportResponse resp = namenodeStub.blockReport(req);
+                if (!resp.getSuccess()) {
+                    System.err.println("✗ BlockReport rechazado por NameNode");
+                    return;
+                }
+            }
+            System.out.println("✓ BlockReport enviado (" + blocks.size() + " bloques)");
+        } catch (Exception e) {
+            System.err.println("✗ Error enviando BlockReport: " + e.getMessage());
+        }
+    }
+
     private void startHeartbeatTimer() {
         heartbeatTimer = new Timer(true);
         heartbeatTimer.scheduleAtFixedRate(new TimerTask() {
@@ -0,0 +1,166 @@
+#include "async_server.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+using grpc::ServerContext;
+using grpc::Status;
+
+namespace {
+
+using AsyncService = griddfs::NameNodeService::AsyncService;
+
+// Etiqueta de la completion queue: cada llamada en curso es un objeto que
+// avanza su propia máquina de estados.
+class CallBase {
+public:
+    virtual ~CallBase() = default;
+    virtual void Proceed(bool ok) = 0;
+};
+
+// RPC unaria: espera la petición, re-arma una llamada nueva para el mismo
+// método, ejecuta el handler síncrono y responde.
+template <typename Req, typename Resp>
+class UnaryCall final : public CallBase {
+public:
+    using RequestFn = void (AsyncService::*)(ServerContext*, Req*,
+                                             grpc::ServerAsyncResponseWriter<Resp>*,
+                                             grpc::CompletionQueue*,
+                                             grpc::ServerCompletionQueue*, void*);
+    using HandlerFn = Status (NameNodeServiceImpl::*)(ServerContext*, const Req*, Resp*);
+
+    static void Arm(AsyncService* service, grpc::ServerCompletionQueue* cq,
+                    NameNodeServiceImpl* impl, RequestFn request, HandlerFn handler) {
+        auto* call = new UnaryCall(service, cq, impl, request, handler);
+        (service->*request)(&call->ctx_, &call->req_, &call->responder_, cq, cq, call);
+    }
+
+    void Proceed(bool ok) override {
+        if (finishing_ || !ok) {  // respuesta enviada o cola cerrándose
+            delete this;
+            return;
+        }
+        Arm(service_, cq_, impl_, request_, handler_);
+
+        Status status = (impl_->*handler_)(&ctx_, &req_, &resp_);
+        finishing_ = true;
+        responder_.Finish(resp_, status, this);
+    }
+
+private:
+    UnaryCall(AsyncService* service, grpc::ServerCompletionQueue* cq,
+              NameNodeServiceImpl* impl, RequestFn request, HandlerFn handler)
+        : service_(service), cq_(cq), impl_(impl), request_(request), handler_(handler),
+          responder_(&ctx_) {}
+
+    AsyncService* service_;
+    grpc::ServerCompletionQueue* cq_;
+    NameNodeServiceImpl* impl_;
+    RequestFn request_;
+    HandlerFn handler_;
+
+    ServerContext ctx_;
+    Req req_;
+    Resp resp_;
+    grpc::ServerAsyncResponseWriter<Resp> responder_;
+    bool finishing_ = false;
+};
+
+template <typename Req, typename Resp>
+void Arm(AsyncService* service, grpc::ServerCompletionQueue* cq, NameNodeServiceImpl* impl,
+         typename UnaryCall<Req, Resp>::RequestFn request,
+         typename UnaryCall<Req, Resp>::HandlerFn handler) {
+    UnaryCall<Req, Resp>::Arm(service, cq, impl, request, handler);
+}
+
+void PinToCpu(std::thread& t, size_t index) {
+    const unsigned ncpu = std::thread::hardware_concurrency();
+    if (ncpu == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % ncpu, &set);
+    if (pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) != 0) {
+        LOG_WARN("[AsyncServer] no se pudo fijar el hilo " << index << " a CPU");
+    }
+}
+
+}  // namespace
+
+AsyncNameNodeServer::AsyncNameNodeServer(NameNodeServiceImpl& impl, AsyncServerOptions opts)
+    : impl_(impl), opts_(std::move(opts)) {
+    if (opts_.num_cqs < 1) opts_.num_cqs = 1;
+    if (opts_.threads_per_cq < 1) opts_.threads_per_cq = 1;
+}
+
+AsyncNameNodeServer::~AsyncNameNodeServer() {
+    if (server_) {
+        Shutdown();
+        Wait();
+    }
+}
+
+bool AsyncNameNodeServer::Start(grpc::ServerBuilder& builder) {
+    builder.AddListeningPort(opts_.address, grpc::InsecureServerCredentials());
+    builder.RegisterService(&service_);
+    for (int i = 0; i < opts_.num_cqs; ++i) {
+        cqs_.push_back(builder.AddCompletionQueue());
+    }
+    server_ = builder.BuildAndStart();
+    if (!server_) return false;
+
+    for (auto& cq : cqs_) {
+        // Una llamada armada por hilo y método: cada hilo puede recibir una
+        // RPC de cualquier tipo sin esperar a que otro re-arme.
+        for (int t = 0; t < opts_.threads_per_cq; ++t) ArmAll(cq.get());
+    }
+    for (auto& cq : cqs_) {
+        for (int t = 0; t < opts_.threads_per_cq; ++t) {
+            threads_.emplace_back(&AsyncNameNodeServer::PollLoop, this, cq.get());
+            if (opts_.pin_cpus) PinToCpu(threads_.back(), threads_.size() - 1);
+        }
+    }
+    return true;
+}
+
+void AsyncNameNodeServer::ArmAll(grpc::ServerCompletionQueue* cq) {
+    AsyncService* s = &service_;
+    NameNodeServiceImpl* impl = &impl_;
+    using namespace griddfs;
+    Arm<LoginRequest, LoginResponse>(s, cq, impl, &AsyncService::RequestLoginUser, &NameNodeServiceImpl::LoginUser);
+    Arm<RegisterUserRequest, RegisterUserResponse>(s, cq, impl, &AsyncService::RequestRegisterUser, &NameNodeServiceImpl::RegisterUser);
+    Arm<CreateFileRequest, CreateFileResponse>(s, cq, impl, &AsyncService::RequestCreateFile, &NameNodeServiceImpl::CreateFile);
+    Arm<GetFileInfoRequest, GetFileInfoResponse>(s, cq, impl, &AsyncService::RequestGetFileInfo, &NameNodeServiceImpl::GetFileInfo);
+    Arm<ListFilesRequest, ListFilesResponse>(s, cq, impl, &AsyncService::RequestListFiles, &NameNodeServiceImpl::ListFiles);
+    Arm<DeleteFileRequest, DeleteFileResponse>(s, cq, impl, &AsyncService::RequestDeleteFile, &NameNodeServiceImpl::DeleteFile);
+    Arm<CreateDirectoryRequest, CreateDirectoryResponse>(s, cq, impl, &AsyncService::RequestCreateDirectory, &NameNodeServiceImpl::CreateDirectory);
+    Arm<RemoveDirectoryRequest, RemoveDirectoryResponse>(s, cq, impl, &AsyncService::RequestRemoveDirectory, &NameNodeServiceImpl::RemoveDirectory);
+    Arm<RegisterDataNodeRequest, RegisterDataNodeResponse>(s, cq, impl, &AsyncService::RequestRegisterDataNode, &NameNodeServiceImpl::RegisterDataNode);
+    Arm<HeartbeatRequest, HeartbeatResponse>(s, cq, impl, &AsyncService::RequestHeartbeat, &NameNodeServiceImpl::Heartbeat);
+    Arm<BlockReportRequest, BlockReportResponse>(s, cq, impl, &AsyncService::RequestBlockReport, &NameNodeServiceImpl::BlockReport);
+}
+
+void AsyncNameNodeServer::PollLoop(grpc::ServerCompletionQueue* cq) {
+    void* tag = nullptr;
+    bool ok = false;
+    while (cq->Next(&tag, &ok)) {
+        static_cast<CallBase*>(tag)->Proceed(ok);
+    }
+}
+
+void AsyncNameNodeServer::Shutdown() {
+    std::call_once(shutdown_once_, [this] {
+        // El servidor primero (espera a las RPC en curso, que aún necesitan
+        // las colas para Finish); después las colas: las llamadas armadas
+        // salen con ok=false y los hilos terminan al vaciarlas.
+        server_->Shutdown();
+        for (auto& cq : cqs_) cq->Shutdown();
+    });
+}
+
+void AsyncNameNodeServer::Wait() {
+    server_->Wait();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+}
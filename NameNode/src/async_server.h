@@ -0,0 +1,64 @@
+#ifndef ASYNC_SERVER_H
+#define ASYNC_SERVER_H
+
+#include <grpcpp/grpcpp.h>
+#include "griddfs.grpc.pb.h"
+#include "namenode_server.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ==============================
+// Servidor gRPC asíncrono (completion queues)
+// ==============================
+//
+// Alternativa al servidor síncrono por defecto: un número fijo de completion
+// queues, cada una atendida por un número fijo de hilos (opcionalmente
+// fijados a CPUs). Cada RPC entrante se despacha al mismo método de
+// NameNodeServiceImpl que usa el servidor síncrono, en el hilo de la cola.
+//
+// Los handlers que esperan (p. ej. CommitMutation en durabilidad sync)
+// ocupan su hilo mientras tanto: dimensionar cqs * threads_per_cq por
+// encima de las escrituras concurrentes esperadas.
+struct AsyncServerOptions {
+    std::string address = "0.0.0.0:50050";
+    int num_cqs = 2;          // completion queues
+    int threads_per_cq = 2;   // hilos que sondean cada cola
+    bool pin_cpus = false;    // hilo i -> CPU (i % núcleos)
+};
+
+class AsyncNameNodeServer {
+public:
+    AsyncNameNodeServer(NameNodeServiceImpl& impl, AsyncServerOptions opts);
+    ~AsyncNameNodeServer();
+    AsyncNameNodeServer(const AsyncNameNodeServer&) = delete;
+    AsyncNameNodeServer& operator=(const AsyncNameNodeServer&) = delete;
+
+    // Construye el servidor y lanza los hilos; false si no pudo escuchar
+    bool Start(grpc::ServerBuilder& builder);
+
+    // Deja de aceptar RPCs, vacía las colas y espera a los hilos
+    void Shutdown();
+
+    // Bloquea hasta que Shutdown() termina
+    void Wait();
+
+    const AsyncServerOptions& options() const { return opts_; }
+
+private:
+    void ArmAll(grpc::ServerCompletionQueue* cq);
+    void PollLoop(grpc::ServerCompletionQueue* cq);
+
+    NameNodeServiceImpl& impl_;
+    AsyncServerOptions opts_;
+    griddfs::NameNodeService::AsyncService service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> cqs_;
+    std::vector<std::thread> threads_;
+    std::once_flag shutdown_once_;
+};
+
+#endif // ASYNC_SERVER_H
@@ -0,0 +1,93 @@
+#include "block_map.h"
+#include "lock_stats.h"
+
+#include <functional>
+
+uint64_t BlockMap::Hash(const std::string& block_id) {
+    return static_cast<uint64_t>(std::hash<std::string>{}(block_id));
+}
+
+// La franja sale de los bits altos; los buckets de cada tabla usan los bajos
+static size_t StripeIndex(uint64_t h, size_t stripes) {
+    return static_cast<size_t>(h >> 32) % stripes;
+}
+
+void BlockMap::AddFile(const std::string& file_key, const FileMetadata& fm) {
+    static lockstats::Site site("BlockMap::AddFile", "stripe.mu");
+    std::string block_id;
+    for (size_t b = 0; b < fm.blocks.size(); ++b) {
+        fm.BlockId(b, &block_id);
+        const uint64_t h = Hash(block_id);
+        Stripe& s = stripes_[StripeIndex(h, kStripes)];
+        lockstats::TimedLock<std::mutex> lock(s.mu, site);
+        s.blocks.emplace(h, Ref{file_key, static_cast<uint32_t>(b)});
+    }
+}
+
+void BlockMap::AddFiles(const std::vector<FileRef>& files) {
+    struct Pending {
+        uint64_t hash;
+        const std::string* file_key;
+        uint32_t index;
+    };
+    std::vector<std::vector<Pending>> by_stripe(kStripes);
+    std::string block_id;
+    for (const FileRef& f : files) {
+        for (size_t b = 0; b < f.second->blocks.size(); ++b) {
+            f.second->BlockId(b, &block_id);
+            const uint64_t h = Hash(block_id);
+            by_stripe[StripeIndex(h, kStripes)].push_back({h, f.first, static_cast<uint32_t>(b)});
+        }
+    }
+    // Cada llamada empieza por una franja distinta para que varias
+    // particiones cargándose a la vez no hagan cola en la misma
+    static lockstats::Site site("BlockMap::AddFiles", "stripe.mu");
+    const size_t start = files.empty() ? 0 : StripeIndex(Hash(*files.front().first), kStripes);
+    for (size_t k = 0; k < kStripes; ++k) {
+        const size_t i = (start + k) % kStripes;
+        if (by_stripe[i].empty()) continue;
+        Stripe& s = stripes_[i];
+        lockstats::TimedLock<std::mutex> lock(s.mu, site);
+        s.blocks.reserve(s.blocks.size() + by_stripe[i].size());
+        for (const Pending& p : by_stripe[i]) s.blocks.emplace(p.hash, Ref{*p.file_key, p.index});
+        std::vector<Pending>().swap(by_stripe[i]);
+    }
+}
+
+void BlockMap::RemoveFile(const std::string& file_key, const FileMetadata& fm) {
+    static lockstats::Site site("BlockMap::RemoveFile", "stripe.mu");
+    std::string block_id;
+    for (size_t b = 0; b < fm.blocks.size(); ++b) {
+        fm.BlockId(b, &block_id);
+        const uint64_t h = Hash(block_id);
+        Stripe& s = stripes_[StripeIndex(h, kStripes)];
+        lockstats::TimedLock<std::mutex> lock(s.mu, site);
+        auto range = s.blocks.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.index == b && it->second.file_key == file_key) {
+                s.blocks.erase(it);
+                break;
+            }
+        }
+    }
+}
+
+bool BlockMap::Find(const std::string& block_id, std::vector<Ref>* out) const {
+    static lockstats::Site site("BlockMap::Find", "stripe.mu");
+    const uint64_t h = Hash(block_id);
+    const Stripe& s = stripes_[StripeIndex(h, kStripes)];
+    lockstats::TimedLock<std::mutex> lock(s.mu, site);
+    auto range = s.blocks.equal_range(h);
+    if (range.first == range.second) return false;
+    for (auto it = range.first; it != range.second; ++it) out->push_back(it->second);
+    return true;
+}
+
+size_t BlockMap::Size() const {
+    size_t n = 0;
+    for (const Stripe& s : stripes_) {
+        std::lock_guard<std::mutex> lock(s.mu);
+        n += s.blocks.size();
+    }
+    return n;
+}
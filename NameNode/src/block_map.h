@@ -0,0 +1,71 @@
+#ifndef BLOCK_MAP_H
+#define BLOCK_MAP_H
+
+#include "metadata.h"
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// ==============================
+// Índice global de bloques
+// ==============================
+//
+// block_id -> (file_key, nº de bloque dentro del archivo). Permite que
+// BlockReport localice cada bloque reportado sin recorrer el espacio de
+// nombres. Las réplicas siguen en FileMetadata (la versión que ven los
+// lectores); aquí solo está dónde buscarlas.
+//
+// La clave es un hash de 64 bits del block_id (no se guarda otra copia del
+// id): Find puede devolver candidatos de más y quien lo usa comprueba que
+// FileMetadata::blocks[index] tenga ese block_id.
+//
+// Concurrencia: la tabla está repartida en kStripes franjas, cada una con
+// su propio lock. Quien modifica un archivo lo refleja aquí mientras tiene
+// el shard.mu de su partición, así que un candidato comprobado bajo ese
+// lock es exacto.
+class BlockMap {
+public:
+    struct Ref {
+        std::string file_key;  // user_id:filename
+        uint32_t index = 0;    // posición en FileMetadata::blocks
+    };
+
+    BlockMap() = default;
+    BlockMap(const BlockMap&) = delete;
+    BlockMap& operator=(const BlockMap&) = delete;
+
+    // Registra los bloques de un archivo que no estaba en el índice
+    void AddFile(const std::string& file_key, const FileMetadata& fm);
+
+    // Registra los archivos de una partición recién cargada (que aún no
+    // estaban en el índice): agrupa los bloques por franja y toma cada
+    // lock una sola vez
+    using FileRef = std::pair<const std::string*, const FileMetadata*>;  // file_key, archivo
+    void AddFiles(const std::vector<FileRef>& files);
+
+    // Quita los bloques de un archivo
+    void RemoveFile(const std::string& file_key, const FileMetadata& fm);
+
+    // Añade a 'out' los candidatos para block_id; false si no hay ninguno
+    bool Find(const std::string& block_id, std::vector<Ref>* out) const;
+
+    size_t Size() const;
+
+private:
+    static constexpr size_t kStripes = 64;
+    struct Stripe {
+        mutable std::mutex mu;
+        std::unordered_multimap<uint64_t, Ref> blocks;  // hash(block_id) -> candidato
+    };
+
+    static uint64_t Hash(const std::string& block_id);
+
+    std::array<Stripe, kStripes> stripes_;
+};
+
+#endif // BLOCK_MAP_H
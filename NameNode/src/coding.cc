@@ -0,0 +1,72 @@
+#include "coding.h"
+
+namespace coding {
+
+void Encoder::PutFixed32(uint32_t v) {
+    char b[4];
+    coding::PutFixed32(b, v);
+    buf_.append(b, sizeof(b));
+}
+
+void Encoder::PutFixed64(uint64_t v) {
+    char b[8];
+    coding::PutFixed64(b, v);
+    buf_.append(b, sizeof(b));
+}
+
+void Encoder::PutVarint(uint64_t v) {
+    while (v >= 0x80) {
+        buf_.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    buf_.push_back(static_cast<char>(v));
+}
+
+void Encoder::PutString(const std::string& s) {
+    PutVarint(s.size());
+    buf_.append(s);
+}
+
+bool Decoder::GetU8(uint8_t* v) {
+    if (p_ == end_) return false;
+    *v = static_cast<uint8_t>(*p_++);
+    return true;
+}
+
+bool Decoder::GetVarint(uint64_t* v) {
+    uint64_t result = 0;
+    for (int shift = 0; shift <= 63 && p_ != end_; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(*p_++);
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Decoder::GetSigned(int64_t* v) {
+    uint64_t u;
+    if (!GetVarint(&u)) return false;
+    *v = static_cast<int64_t>(u);
+    return true;
+}
+
+bool Decoder::GetString(std::string* s) {
+    uint64_t n;
+    if (!GetVarint(&n) || remaining() < n) return false;
+    s->assign(p_, static_cast<size_t>(n));
+    p_ += n;
+    return true;
+}
+
+bool Decoder::GetStringView(std::string_view* s) {
+    uint64_t n;
+    if (!GetVarint(&n) || remaining() < n) return false;
+    *s = std::string_view(p_, static_cast<size_t>(n));
+    p_ += n;
+    return true;
+}
+
+}  // namespace coding
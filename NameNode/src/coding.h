@@ -0,0 +1,72 @@
+#ifndef CODING_H
+#define CODING_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// ==============================
+// Codificación binaria compacta
+// ==============================
+//
+// Enteros fijos en little endian y varints (7 bits por byte), más cadenas
+// con prefijo de longitud. Lo usan el edit log y el fsimage binario.
+namespace coding {
+
+inline void PutFixed32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<char>(v >> (8 * i));
+}
+
+inline void PutFixed64(char* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<char>(v >> (8 * i));
+}
+
+inline uint32_t GetFixed32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+inline uint64_t GetFixed64(const char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    return v;
+}
+
+class Encoder {
+public:
+    void PutU8(uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+    void PutFixed32(uint32_t v);
+    void PutFixed64(uint64_t v);
+    void PutVarint(uint64_t v);
+    void PutSigned(int64_t v) { PutVarint(static_cast<uint64_t>(v)); }
+    void PutString(const std::string& s);
+    std::string& data() { return buf_; }
+    const std::string& data() const { return buf_; }
+    std::string Release() { return std::move(buf_); }
+
+private:
+    std::string buf_;
+};
+
+// Lectura secuencial; cada Get devuelve false si los datos se acaban
+class Decoder {
+public:
+    Decoder(const char* data, size_t n) : p_(data), end_(data + n) {}
+    explicit Decoder(const std::string& data) : Decoder(data.data(), data.size()) {}
+    bool GetU8(uint8_t* v);
+    bool GetVarint(uint64_t* v);
+    bool GetSigned(int64_t* v);
+    bool GetString(std::string* s);
+    bool GetStringView(std::string_view* s);  // apunta a los datos de entrada
+    bool done() const { return p_ == end_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+}  // namespace coding
+
+#endif // CODING_H
@@ -0,0 +1,37 @@
+#include "control_plane.h"
+
+using grpc::ServerContext;
+using grpc::Status;
+
+Status ControlPlaneService::RegisterDataNode(ServerContext* ctx,
+                                             const griddfs::RegisterDataNodeRequest* request,
+                                             griddfs::RegisterDataNodeResponse* response) {
+    return impl_.RegisterDataNode(ctx, request, response);
+}
+
+Status ControlPlaneService::Heartbeat(ServerContext* ctx,
+                                      const griddfs::HeartbeatRequest* request,
+                                      griddfs::HeartbeatResponse* response) {
+    return impl_.Heartbeat(ctx, request, response);
+}
+
+Status ControlPlaneService::BlockReport(ServerContext* ctx,
+                                        const griddfs::BlockReportRequest* request,
+                                        griddfs::BlockReportResponse* response) {
+    return impl_.BlockReport(ctx, request, response);
+}
+
+std::unique_ptr<grpc::Server> StartControlPlane(ControlPlaneService& service,
+                                                const std::string& address,
+                                                int threads) {
+    if (threads < 1) threads = 1;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+    builder.RegisterService(&service);
+    // Pool propio: los pollers mínimos quedan reservados para DataNodes
+    // aunque el servidor principal esté saturado (su ResourceQuota es otra).
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::NUM_CQS, 1);
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, threads);
+    builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, threads);
+    return builder.BuildAndStart();
+}
@@ -0,0 +1,56 @@
+#ifndef CONTROL_PLANE_H
+#define CONTROL_PLANE_H
+
+#include <grpcpp/grpcpp.h>
+#include "griddfs.grpc.pb.h"
+#include "namenode_server.h"
+
+#include <memory>
+#include <string>
+
+// ==============================
+// Plano de control (RPCs de DataNodes)
+// ==============================
+//
+// Servidor gRPC aparte, en su propio puerto (control_address), que solo
+// atiende RegisterDataNode, Heartbeat y BlockReport. Tiene su propio pool
+// de hilos (control_threads reservados), así que una avalancha de RPCs de
+// clientes en el puerto principal no retrasa los heartbeats. La lógica es
+// la de NameNodeServiceImpl; el resto de métodos responde UNIMPLEMENTED.
+//
+// La separación es solo de hilos, no de locks:
+//   - Heartbeat no toma ningún lock (estadísticas atómicas del nodo).
+//   - RegisterDataNode toma reg_mu_ del registro, que ningún RPC de
+//     cliente toma (leen la tabla de nodos por RCU).
+//   - BlockReport toma shard.mu de cada partición con bloques reportados,
+//     el mismo lock que CreateFile/DeleteFile: compite con las escrituras
+//     de clientes de esas particiones.
+// La CPU también se comparte. `namenode_bench heartbeat` mide las tres
+// durante una tormenta de clientes, por los dos puertos.
+class ControlPlaneService final : public griddfs::NameNodeService::Service {
+public:
+    explicit ControlPlaneService(NameNodeServiceImpl& impl) : impl_(impl) {}
+
+    grpc::Status RegisterDataNode(grpc::ServerContext* context,
+                                  const griddfs::RegisterDataNodeRequest* request,
+                                  griddfs::RegisterDataNodeResponse* response) override;
+
+    grpc::Status Heartbeat(grpc::ServerContext* context,
+                           const griddfs::HeartbeatRequest* request,
+                           griddfs::HeartbeatResponse* response) override;
+
+    grpc::Status BlockReport(grpc::ServerContext* context,
+                             const griddfs::BlockReportRequest* request,
+                             griddfs::BlockReportResponse* response) override;
+
+private:
+    NameNodeServiceImpl& impl_;
+};
+
+// Arranca el servidor del plano de control con 'threads' hilos de sondeo
+// siempre activos. nullptr si no pudo escuchar en 'address'.
+std::unique_ptr<grpc::Server> StartControlPlane(ControlPlaneService& service,
+                                                const std::string& address,
+                                                int threads);
+
+#endif // CONTROL_PLANE_H
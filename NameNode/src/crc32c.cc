@@ -0,0 +1,154 @@
+#include "crc32c.h"
+
+#include <array>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HW 1
+#include <immintrin.h>
+#endif
+
+namespace crc32c {
+namespace {
+
+constexpr uint32_t kPoly = 0x82F63B78u;  // polinomio de Castagnoli, reflejado
+
+// Tablas "slicing-by-4": cuatro bytes por iteración
+struct Tables {
+    std::array<std::array<uint32_t, 256>, 4> t;
+    Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ kPoly : (c >> 1);
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t s = 1; s < 4; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+const Tables& GetTables() {
+    static const Tables tables;
+    return tables;
+}
+
+uint32_t ExtendSoftware(uint32_t crc, const uint8_t* p, size_t n) {
+    const auto& t = GetTables().t;
+    uint32_t c = ~crc;
+    while (n >= 4) {
+        c ^= static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+             (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        c = t[3][c & 0xFF] ^ t[2][(c >> 8) & 0xFF] ^ t[1][(c >> 16) & 0xFF] ^ t[0][c >> 24];
+        p += 4;
+        n -= 4;
+    }
+    while (n-- > 0) c = t[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return ~c;
+}
+
+#ifdef CRC32C_HW
+
+// =============================================
+// SSE4.2 + PCLMUL
+// =============================================
+//
+// La instrucción crc32 tiene latencia 3 y rendimiento 1 por ciclo: se
+// calculan tres flujos independientes de kStride bytes y se combinan
+// multiplicando (PCLMUL) cada CRC parcial por x^(8·bytes que le siguen).
+
+constexpr size_t kStride = 4096;
+
+// a·b mod P en la representación reflejada (software; solo para constantes)
+uint32_t MultModP(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31, p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+    }
+    return p;
+}
+
+// x^(8·n) mod P: desplazar un CRC n bytes de ceros
+uint32_t ShiftConstant(size_t n) {
+    uint32_t result = 1u << 31;  // x^0
+    uint32_t base = 1u << 23;    // x^8
+    for (; n > 0; n >>= 1) {
+        if (n & 1) result = MultModP(result, base);
+        base = MultModP(base, base);
+    }
+    return result;
+}
+
+__attribute__((target("sse4.2,pclmul")))
+inline uint32_t MultModPHardware(uint32_t a, uint32_t k) {
+    const __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(a)),
+                                              _mm_cvtsi32_si128(static_cast<int>(k)), 0x00);
+    // El producto reflejado de 63 bits queda un bit corto; la mitad baja se
+    // reduce con la propia instrucción crc32
+    const uint64_t v = static_cast<uint64_t>(_mm_cvtsi128_si64(prod)) << 1;
+    return _mm_crc32_u32(0, static_cast<uint32_t>(v)) ^ static_cast<uint32_t>(v >> 32);
+}
+
+__attribute__((target("sse4.2,pclmul")))
+uint32_t ExtendHardware(uint32_t crc, const uint8_t* p, size_t n) {
+    static const uint32_t k1 = ShiftConstant(kStride);
+    static const uint32_t k2 = ShiftConstant(2 * kStride);
+
+    uint64_t c = ~crc & 0xFFFFFFFFu;
+    while (n > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+        c = _mm_crc32_u8(static_cast<uint32_t>(c), *p++);
+        --n;
+    }
+    auto load = [](const uint8_t* q) {
+        uint64_t v;
+        __builtin_memcpy(&v, q, sizeof(v));
+        return v;
+    };
+    while (n >= 3 * kStride) {
+        uint64_t c1 = 0, c2 = 0;
+        for (size_t i = 0; i < kStride; i += 8) {
+            c = _mm_crc32_u64(c, load(p + i));
+            c1 = _mm_crc32_u64(c1, load(p + kStride + i));
+            c2 = _mm_crc32_u64(c2, load(p + 2 * kStride + i));
+        }
+        c = MultModPHardware(static_cast<uint32_t>(c), k2) ^
+            MultModPHardware(static_cast<uint32_t>(c1), k1) ^ c2;
+        p += 3 * kStride;
+        n -= 3 * kStride;
+    }
+    for (; n >= 8; p += 8, n -= 8) c = _mm_crc32_u64(c, load(p));
+    while (n-- > 0) c = _mm_crc32_u8(static_cast<uint32_t>(c), *p++);
+    return ~static_cast<uint32_t>(c);
+}
+
+#endif  // CRC32C_HW
+
+using ExtendFn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+ExtendFn Select() {
+#ifdef CRC32C_HW
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("pclmul")) return ExtendHardware;
+#endif
+    return ExtendSoftware;
+}
+
+}  // namespace
+
+uint32_t Extend(uint32_t crc, const void* data, size_t n) {
+    static const ExtendFn fn = Select();
+    return fn(crc, static_cast<const uint8_t*>(data), n);
+}
+
+bool Accelerated() {
+#ifdef CRC32C_HW
+    return Select() != ExtendSoftware;
+#else
+    return false;
+#endif
+}
+
+}  // namespace crc32c
@@ -0,0 +1,28 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+// ==============================
+// CRC32C (Castagnoli)
+// ==============================
+//
+// Suma de verificación de los registros del edit log y de las secciones
+// del fsimage. Con SSE4.2 y PCLMUL (se comprueba al arrancar) usa la
+// instrucción crc32; si no, tablas.
+namespace crc32c {
+
+// Continúa un CRC ya calculado con 'n' bytes más
+uint32_t Extend(uint32_t crc, const void* data, size_t n);
+
+inline uint32_t Value(const void* data, size_t n) {
+    return Extend(0, data, n);
+}
+
+// true si Extend usa la implementación por hardware
+bool Accelerated();
+
+}  // namespace crc32c
+
+#endif // CRC32C_H
@@ -0,0 +1,146 @@
+#include "datanode_registry.h"
+#include "rcu.h"
+#include "lock_stats.h"
+
+#include <chrono>
+
+namespace {
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+DataNodeRegistry::DataNodeRegistry() {
+    nodes_.store(new NodeTable());
+}
+
+DataNodeRegistry::~DataNodeRegistry() {
+    delete nodes_.load();
+}
+
+NodeIndex DataNodeRegistry::Register(const griddfs::DataNodeInfo& info) {
+    auto node = std::make_shared<Node>();
+    node->info = info;
+    node->info.clear_free_space();
+    node->registered = true;
+    node->free_space.store(info.free_space(), std::memory_order_relaxed);
+    node->last_heartbeat_ms.store(NowMs(), std::memory_order_relaxed);
+
+    static lockstats::Site site("RegisterDataNode", "reg_mu_");
+    lockstats::TimedLock<std::mutex> lock(reg_mu_, site);
+    return PublishUnlocked(std::move(node));
+}
+
+NodeIndex DataNodeRegistry::IndexOf(std::string_view id, std::string_view address) {
+    {
+        rcu::ReadGuard guard;
+        const NodeTable* nodes = nodes_.load();
+        auto it = nodes->by_id.find(id);
+        if (it != nodes->by_id.end()) {
+            const Node& n = *nodes->nodes[it->second];
+            if (n.registered || n.info.address() == address) return it->second;
+        }
+    }
+    auto node = std::make_shared<Node>();
+    node->info.set_id(id.data(), id.size());
+    node->info.set_address(address.data(), address.size());
+
+    static lockstats::Site site("DataNodeIndexOf", "reg_mu_");
+    lockstats::TimedLock<std::mutex> lock(reg_mu_, site);
+    // Puede haberse registrado mientras tanto: su dirección manda
+    const NodeTable* cur = nodes_.load();
+    auto it = cur->by_id.find(node->info.id());
+    if (it != cur->by_id.end() && cur->nodes[it->second]->registered) return it->second;
+    return PublishUnlocked(std::move(node));
+}
+
+NodeIndex DataNodeRegistry::PublishUnlocked(std::shared_ptr<Node> node) {
+    const NodeTable* cur = nodes_.load();
+    auto next = std::make_unique<NodeTable>(*cur);
+    auto it = next->by_id.find(node->info.id());
+    NodeIndex index;
+    if (it == next->by_id.end()) {
+        index = static_cast<NodeIndex>(next->nodes.size());
+        next->nodes.push_back(nullptr);
+    } else {
+        index = it->second;
+        if (next->nodes[index]->registered) --next->registered;
+        // La clave apunta al id del nodo reemplazado: pasa a la del nuevo
+        next->by_id.erase(it);
+    }
+    next->by_id.emplace(node->info.id(), index);
+    if (node->registered) ++next->registered;
+    next->nodes[index] = std::move(node);
+    nodes_.store(next.release());
+    retired_.Retire(cur);
+    return index;
+}
+
+bool DataNodeRegistry::Heartbeat(const std::string& id, int64_t free_space) {
+    rcu::ReadGuard guard;
+    const NodeTable* nodes = nodes_.load();
+    auto it = nodes->by_id.find(id);
+    if (it == nodes->by_id.end()) return false;
+    Node& node = *nodes->nodes[it->second];
+    if (!node.registered) return false;
+    node.free_space.store(free_space, std::memory_order_relaxed);
+    node.last_heartbeat_ms.store(NowMs(), std::memory_order_relaxed);
+    return true;
+}
+
+bool DataNodeRegistry::Find(const std::string& id, griddfs::DataNodeInfo* out, NodeIndex* index) const {
+    rcu::ReadGuard guard;
+    const NodeTable* nodes = nodes_.load();
+    auto it = nodes->by_id.find(id);
+    if (it == nodes->by_id.end() || !nodes->nodes[it->second]->registered) return false;
+    *out = ToInfo(*nodes->nodes[it->second]);
+    if (index != nullptr) *index = it->second;
+    return true;
+}
+
+std::vector<griddfs::DataNodeInfo> DataNodeRegistry::Snapshot(std::vector<NodeIndex>* indices) const {
+    rcu::ReadGuard guard;
+    const NodeTable* nodes = nodes_.load();
+    std::vector<griddfs::DataNodeInfo> out;
+    out.reserve(nodes->registered);
+    if (indices != nullptr) {
+        indices->clear();
+        indices->reserve(nodes->registered);
+    }
+    for (size_t i = 0; i < nodes->nodes.size(); ++i) {
+        if (!nodes->nodes[i]->registered) continue;
+        out.push_back(ToInfo(*nodes->nodes[i]));
+        if (indices != nullptr) indices->push_back(static_cast<NodeIndex>(i));
+    }
+    return out;
+}
+
+void DataNodeRegistry::Expand(NodeIndex node, griddfs::DataNodeInfo* out) const {
+    rcu::ReadGuard guard;
+    const NodeTable* nodes = nodes_.load();
+    if (node >= nodes->nodes.size()) return;
+    *out = ToInfo(*nodes->nodes[node]);
+}
+
+void DataNodeRegistry::Lookup(NodeIndex node, std::string* id, std::string* address) const {
+    rcu::ReadGuard guard;
+    const NodeTable* nodes = nodes_.load();
+    if (node >= nodes->nodes.size()) return;
+    const griddfs::DataNodeInfo& info = nodes->nodes[node]->info;
+    *id = info.id();
+    *address = info.address();
+}
+
+size_t DataNodeRegistry::Size() const {
+    rcu::ReadGuard guard;
+    return nodes_.load()->registered;
+}
+
+griddfs::DataNodeInfo DataNodeRegistry::ToInfo(const Node& node) {
+    griddfs::DataNodeInfo info = node.info;
+    if (node.registered) info.set_free_space(node.free_space.load(std::memory_order_relaxed));
+    return info;
+}
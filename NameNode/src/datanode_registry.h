@@ -0,0 +1,90 @@
+#ifndef DATANODE_REGISTRY_H
+#define DATANODE_REGISTRY_H
+
+#include "griddfs.pb.h"
+#include "metadata.h"
+#include "rcu.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ==============================
+// Registro de DataNodes
+// ==============================
+//
+// Dominio de concurrencia propio, independiente del espacio de nombres:
+//   - La tabla de nodos es inmutable y se publica por RCU; solo
+//     RegisterDataNode (raro) y la primera réplica de un nodo aún no
+//     visto (al cargar) toman reg_mu_ y publican una copia.
+//   - Las estadísticas de cada nodo (free_space, último heartbeat) son
+//     atómicas: Heartbeat no toma ningún lock.
+//   - Snapshot() devuelve una vista de un único conjunto de nodos publicado,
+//     que es lo que usa la colocación de bloques.
+//
+// Cada nodo tiene un NodeIndex que no cambia nunca (ni al volver a
+// registrarse con otra dirección): es lo que guardan las réplicas de los
+// bloques, y Expand() lo convierte en DataNodeInfo al responder. Los nodos
+// que solo se conocen por el fsimage o el edit log conservan la dirección
+// guardada hasta que se registran, y no se usan para colocar bloques.
+class DataNodeRegistry : public DataNodeNames {
+public:
+    DataNodeRegistry();
+    ~DataNodeRegistry() override;
+    DataNodeRegistry(const DataNodeRegistry&) = delete;
+    DataNodeRegistry& operator=(const DataNodeRegistry&) = delete;
+
+    // Alta o actualización (dirección/capacidad) de un DataNode
+    NodeIndex Register(const griddfs::DataNodeInfo& info);
+
+    // Actualiza free_space; false si el nodo no está registrado
+    bool Heartbeat(const std::string& id, int64_t free_space);
+
+    // Nodo registrado con las estadísticas actuales; false si no existe
+    bool Find(const std::string& id, griddfs::DataNodeInfo* out, NodeIndex* index = nullptr) const;
+
+    // Todos los nodos registrados de una misma versión publicada de la
+    // tabla (y, si se pide, el índice de cada uno)
+    std::vector<griddfs::DataNodeInfo> Snapshot(std::vector<NodeIndex>* indices = nullptr) const;
+
+    // Estado actual de un nodo para una respuesta (sin capacidad ni
+    // espacio libre si aún no se ha registrado)
+    void Expand(NodeIndex node, griddfs::DataNodeInfo* out) const;
+
+    // DataNodeNames (carga del fsimage/edit log y checkpoints)
+    NodeIndex IndexOf(std::string_view id, std::string_view address) override;
+    void Lookup(NodeIndex node, std::string* id, std::string* address) const override;
+
+    size_t Size() const;  // nodos registrados
+
+private:
+    // Parte mutable de un nodo; compartida entre versiones de la tabla
+    struct Node {
+        griddfs::DataNodeInfo info;              // id, address, capacity (inmutables tras publicar)
+        bool registered = false;                 // false: solo conocido por las réplicas guardadas
+        std::atomic<int64_t> free_space{0};
+        std::atomic<int64_t> last_heartbeat_ms{0};
+    };
+    struct NodeTable {
+        // Claves: vistas de info.id() de nodes (cada Node lo conserva mientras
+        // esté en la tabla), así que se busca por string_view sin copiar
+        std::unordered_map<std::string_view, NodeIndex> by_id;
+        std::vector<std::shared_ptr<Node>> nodes;  // por NodeIndex
+        size_t registered = 0;
+    };
+
+    static griddfs::DataNodeInfo ToInfo(const Node& node);
+    // Publica 'node' en su índice (o en uno nuevo); requiere reg_mu_
+    NodeIndex PublishUnlocked(std::shared_ptr<Node> node);
+
+    std::mutex reg_mu_;                             // serializa publicadores
+    std::atomic<const NodeTable*> nodes_{nullptr};  // leer bajo rcu::ReadGuard
+    rcu::RetireList retired_;                       // (reg_mu_)
+};
+
+#endif // DATANODE_REGISTRY_H
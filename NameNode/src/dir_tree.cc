@@ -0,0 +1,262 @@
+#include "dir_tree.h"
+
+#include <algorithm>
+#include <functional>
+
+DirTree::DirTree() {
+    auto empty = std::make_shared<const Bucket>();
+    buckets_.fill(empty);
+}
+
+size_t DirTree::BucketOf(const std::string& key) {
+    // Bits altos, como ShardVersion::BucketOf (los bajos eligieron la partición)
+    return (std::hash<std::string>{}(key) >> 24) % kBuckets;
+}
+
+size_t DirTree::PartOf(std::string_view name, size_t nparts) {
+    return std::hash<std::string_view>{}(name) & (nparts - 1);
+}
+
+bool DirTree::Split(const std::string& key, std::string* parent, std::string* name) {
+    const size_t colon = key.find(':');
+    const size_t slash = key.rfind('/');
+    if (colon == std::string::npos || slash == std::string::npos || slash < colon) return false;
+    parent->assign(key, 0, slash);
+    name->assign(key, slash + 1, std::string::npos);
+    return true;
+}
+
+const DirTree::Node* DirTree::FindNode(const std::string& key) const {
+    const Bucket& bucket = *buckets_[BucketOf(key)];
+    auto it = bucket.find(key);
+    return it == bucket.end() ? nullptr : it->second.get();
+}
+
+DirTree::Node* DirTree::MutableNode(const std::string& key) {
+    auto& slot = buckets_[BucketOf(key)];
+    auto bucket = std::make_shared<Bucket>(*slot);
+    auto& entry = (*bucket)[key];
+    std::shared_ptr<Node> node;
+    if (entry) {
+        node = std::make_shared<Node>(*entry);
+    } else {
+        node = std::make_shared<Node>();
+        node->parts.push_back(std::make_shared<const Part>());
+    }
+    entry = node;
+    slot = std::move(bucket);
+    return node.get();
+}
+
+DirTree::Part& DirTree::MutablePart(Node& node, const std::string& name) {
+    auto& slot = node.parts[PartOf(name, node.parts.size())];
+    auto copy = std::make_shared<Part>(*slot);
+    Part& part = *copy;
+    slot = std::move(copy);
+    return part;
+}
+
+void DirTree::Grow(Node& node) {
+    if (node.entries <= node.parts.size() * kPartEntries) return;
+    size_t n = node.parts.size() * 2;
+    while (node.entries > n * kPartEntries) n *= 2;
+    std::vector<std::shared_ptr<Part>> parts(n);
+    for (auto& p : parts) p = std::make_shared<Part>();
+    for (const auto& p : node.parts) {
+        for (const auto& d : p->dirs) parts[PartOf(d.first, n)]->dirs.insert(d);
+        for (const auto& f : p->files) parts[PartOf(f, n)]->files.insert(f);
+    }
+    node.parts.assign(parts.begin(), parts.end());
+}
+
+void DirTree::Prune(const std::string& key, const Node& node) {
+    if (node.explicit_dir || node.entries > 0) return;
+    auto& slot = buckets_[BucketOf(key)];
+    auto bucket = std::make_shared<Bucket>(*slot);
+    bucket->erase(key);  // destruye 'node'
+    slot = std::move(bucket);
+}
+
+// 'key' acaba de pasar a contener archivos (has) o a no contener ninguno:
+// se marca en su padre, y así hacia la raíz mientras el padre también cambie
+void DirTree::SetHasFiles(std::string key, bool has) {
+    std::string parent, name;
+    while (Split(key, &parent, &name)) {
+        if (!has && FindNode(parent) == nullptr) return;
+        Node* node = MutableNode(parent);
+        Part& part = MutablePart(*node, name);
+        bool changed;
+        if (has) {
+            auto res = part.dirs.emplace(name, 0);
+            if (res.second) ++node->entries;
+            res.first->second |= kHasFiles;
+            changed = ++node->live == 1;
+            Grow(*node);
+        } else {
+            auto it = part.dirs.find(name);
+            if (it != part.dirs.end()) {
+                it->second &= ~kHasFiles;
+                if (it->second == 0) {
+                    part.dirs.erase(it);
+                    --node->entries;
+                }
+            }
+            changed = --node->live == 0;
+            Prune(parent, *node);
+        }
+        if (!changed) return;
+        key = std::move(parent);
+    }
+}
+
+void DirTree::AddFile(const std::string& file_key) {
+    std::string parent, name;
+    if (!Split(file_key, &parent, &name)) return;  // sin '/': no aparece en ningún listado
+    const Node* cur = FindNode(parent);
+    if (cur != nullptr && cur->parts[PartOf(name, cur->parts.size())]->files.count(name) > 0) return;
+    Node* node = MutableNode(parent);
+    MutablePart(*node, name).files.insert(name);
+    ++node->entries;
+    const bool first = ++node->live == 1;
+    Grow(*node);
+    if (first) SetHasFiles(parent, true);
+}
+
+void DirTree::RemoveFile(const std::string& file_key) {
+    std::string parent, name;
+    if (!Split(file_key, &parent, &name)) return;
+    const Node* cur = FindNode(parent);
+    if (cur == nullptr || cur->parts[PartOf(name, cur->parts.size())]->files.count(name) == 0) return;
+    Node* node = MutableNode(parent);
+    MutablePart(*node, name).files.erase(name);
+    --node->entries;
+    const bool last = --node->live == 0;
+    Prune(parent, *node);
+    if (last) SetHasFiles(parent, false);
+}
+
+void DirTree::AddDirectory(const std::string& dir_key) {
+    const Node* cur = FindNode(dir_key);
+    if (cur != nullptr && cur->explicit_dir) return;
+    MutableNode(dir_key)->explicit_dir = true;
+    ++explicit_dirs_;
+    std::string parent, name;
+    if (!Split(dir_key, &parent, &name)) return;
+    Node* node = MutableNode(parent);
+    auto res = MutablePart(*node, name).dirs.emplace(name, 0);
+    if (res.second) ++node->entries;
+    res.first->second |= kExplicit;
+    Grow(*node);
+}
+
+void DirTree::RemoveDirectory(const std::string& dir_key) {
+    const Node* cur = FindNode(dir_key);
+    if (cur == nullptr || !cur->explicit_dir) return;
+    Node* node = MutableNode(dir_key);
+    node->explicit_dir = false;
+    --explicit_dirs_;
+    Prune(dir_key, *node);
+    std::string parent, name;
+    if (!Split(dir_key, &parent, &name) || FindNode(parent) == nullptr) return;
+    Node* pnode = MutableNode(parent);
+    Part& part = MutablePart(*pnode, name);
+    auto it = part.dirs.find(name);
+    if (it != part.dirs.end()) {
+        it->second &= ~kExplicit;
+        if (it->second == 0) {
+            part.dirs.erase(it);
+            --pnode->entries;
+        }
+    }
+    Prune(parent, *pnode);
+}
+
+bool DirTree::IsDirectory(const std::string& dir_key) const {
+    const Node* node = FindNode(dir_key);
+    return node != nullptr && node->explicit_dir;
+}
+
+void DirTree::List(const std::string& dir_key, std::vector<std::string>* dirs,
+                   std::vector<std::string>* files) const {
+    const Node* node = FindNode(dir_key);
+    if (node == nullptr) return;
+    for (const auto& part : node->parts) {
+        for (const auto& d : part->dirs) {
+            if (!d.first.empty()) dirs->push_back(d.first);
+        }
+        files->insert(files->end(), part->files.begin(), part->files.end());
+    }
+    std::sort(dirs->begin(), dirs->end());
+    std::sort(files->begin(), files->end());
+}
+
+void DirTree::CollectDirectories(std::vector<const std::string*>* out) const {
+    out->reserve(out->size() + explicit_dirs_);
+    for (const auto& bucket : buckets_) {
+        for (const auto& kv : *bucket) {
+            if (kv.second->explicit_dir) out->push_back(&kv.first);
+        }
+    }
+}
+
+// =============================================
+// Construcción al cargar
+// =============================================
+
+void DirTree::Builder::AddFile(const std::string& file_key) {
+    std::string parent, name;
+    if (!Split(file_key, &parent, &name)) return;
+    std::vector<std::string>& files = nodes_[parent].files;
+    files.push_back(std::move(name));
+    if (files.size() > 1) return;
+    // Primer archivo del directorio: cada antepasado se marca en su padre;
+    // si ya lo estaba, los de más arriba también
+    std::string key = std::move(parent);
+    while (Split(key, &parent, &name)) {
+        uint8_t& bits = nodes_[parent].dirs[name];
+        if (bits & kHasFiles) break;
+        bits |= kHasFiles;
+        key = std::move(parent);
+    }
+}
+
+void DirTree::Builder::AddDirectory(const std::string& dir_key) {
+    MutableEntry& entry = nodes_[dir_key];
+    if (entry.explicit_dir) return;
+    entry.explicit_dir = true;
+    std::string parent, name;
+    if (Split(dir_key, &parent, &name)) nodes_[parent].dirs[name] |= kExplicit;
+}
+
+DirTree DirTree::Builder::Finish() {
+    DirTree tree;
+    std::array<std::shared_ptr<Bucket>, kBuckets> buckets;
+    for (auto& b : buckets) b = std::make_shared<Bucket>();
+    for (auto& kv : nodes_) {
+        MutableEntry& m = kv.second;
+        auto node = std::make_shared<Node>();
+        node->explicit_dir = m.explicit_dir;
+        node->entries = m.dirs.size() + m.files.size();
+        node->live = m.files.size();
+        for (const auto& d : m.dirs) {
+            if (d.second & kHasFiles) ++node->live;
+        }
+        size_t n = 1;
+        while (node->entries > n * kPartEntries) n *= 2;
+        std::vector<std::shared_ptr<Part>> parts(n);
+        for (auto& p : parts) p = std::make_shared<Part>();
+        if (n == 1) {
+            parts[0]->dirs = std::move(m.dirs);
+        } else {
+            for (auto& d : m.dirs) parts[PartOf(d.first, n)]->dirs.insert(std::move(d));
+        }
+        for (auto& p : parts) p->files.reserve(m.files.size() / n + m.files.size() / (4 * n) + 1);
+        for (auto& f : m.files) parts[PartOf(f, n)]->files.insert(std::move(f));
+        node->parts.assign(parts.begin(), parts.end());
+        if (m.explicit_dir) ++tree.explicit_dirs_;
+        (*buckets[BucketOf(kv.first)])[kv.first] = std::move(node);
+    }
+    nodes_.clear();
+    for (size_t b = 0; b < kBuckets; ++b) tree.buckets_[b] = std::move(buckets[b]);
+    return tree;
+}
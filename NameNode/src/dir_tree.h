@@ -0,0 +1,107 @@
+#ifndef DIR_TREE_H
+#define DIR_TREE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// ==============================
+// Árbol de directorios
+// ==============================
+//
+// Índice jerárquico de una partición del espacio de nombres: para cada
+// directorio ("user_id:ruta") los nombres de sus subdirectorios y archivos,
+// así que listar uno cuesta O(hijos). Los metadatos de cada archivo siguen
+// en ShardVersion::files (por file_key).
+//
+// El hijo de "user_id:/a/b" es lo que sigue a la última '/' y su padre lo
+// anterior; la raíz "/" es la ruta vacía ("user_id:"). Cada usuario tiene
+// así su propio subárbol: listar no toca entradas de otros usuarios de la
+// misma partición, por muchas que tengan. Un subdirectorio aparece en su
+// padre si se creó con CreateDirectory o si contiene algún archivo (a
+// cualquier profundidad).
+//
+// Inmutable tras publicarse. Cada modificación (solo sobre copias aún no
+// publicadas) copia el bucket del directorio, su nodo y la parte de sus
+// hijos donde cae el nombre; el resto se comparte con la versión anterior.
+class DirTree {
+public:
+    static constexpr size_t kBuckets = 256;
+
+    DirTree();
+
+    // Solo sobre copias aún no publicadas; repetir una operación no cambia nada
+    void AddFile(const std::string& file_key);
+    void RemoveFile(const std::string& file_key);
+    void AddDirectory(const std::string& dir_key);
+    void RemoveDirectory(const std::string& dir_key);
+
+    // Creado con CreateDirectory (y no eliminado)
+    bool IsDirectory(const std::string& dir_key) const;
+    size_t DirectoryCount() const { return explicit_dirs_; }
+
+    // Hijos de dir_key ordenados por nombre (nada si no existe). Los
+    // subdirectorios de nombre vacío ("/a/" en "/a") no se devuelven
+    void List(const std::string& dir_key, std::vector<std::string>* dirs,
+              std::vector<std::string>* files) const;
+
+    // Claves de los directorios creados con CreateDirectory (válidas
+    // mientras viva esta versión)
+    void CollectDirectories(std::vector<const std::string*>* out) const;
+
+    // Construcción de una vez (carga del fsimage) sin copias intermedias
+    class Builder;
+
+private:
+    static constexpr uint8_t kExplicit = 1;  // el hijo se creó con CreateDirectory
+    static constexpr uint8_t kHasFiles = 2;  // el hijo contiene archivos
+    static constexpr size_t kPartEntries = 128;  // entradas por parte antes de repartir
+
+    struct Part {
+        std::unordered_map<std::string, uint8_t> dirs;  // nombre -> kExplicit | kHasFiles
+        std::unordered_set<std::string> files;
+    };
+    struct Node {
+        bool explicit_dir = false;
+        uint64_t live = 0;     // archivos + subdirectorios con archivos
+        size_t entries = 0;    // dirs + files de todas las partes
+        std::vector<std::shared_ptr<const Part>> parts;  // potencia de 2, por hash del nombre
+    };
+    using Bucket = std::unordered_map<std::string, std::shared_ptr<const Node>>;
+
+    static size_t BucketOf(const std::string& key);
+    static size_t PartOf(std::string_view name, size_t nparts);
+    static bool Split(const std::string& key, std::string* parent, std::string* name);
+
+    const Node* FindNode(const std::string& key) const;
+    Node* MutableNode(const std::string& key);  // copia (o crea) el nodo en esta versión
+    static Part& MutablePart(Node& node, const std::string& name);
+    static void Grow(Node& node);                // reparte en más partes si hace falta
+    void Prune(const std::string& key, const Node& node);  // lo quita si quedó vacío
+    void SetHasFiles(std::string key, bool has);           // propaga hacia la raíz
+
+    std::array<std::shared_ptr<const Bucket>, kBuckets> buckets_;
+    size_t explicit_dirs_ = 0;
+};
+
+class DirTree::Builder {
+public:
+    void AddFile(const std::string& file_key);  // cada archivo una sola vez
+    void AddDirectory(const std::string& dir_key);
+    DirTree Finish();
+
+private:
+    struct MutableEntry {
+        bool explicit_dir = false;
+        std::unordered_map<std::string, uint8_t> dirs;
+        std::vector<std::string> files;
+    };
+    std::unordered_map<std::string, MutableEntry> nodes_;
+};
+
+#endif // DIR_TREE_H
@@ -0,0 +1,428 @@
+#include "edit_log.h"
+#include "coding.h"
+#include "crc32c.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[8] = {'G', 'D', 'F', 'S', 'E', 'D', 'T', '1'};
+constexpr size_t kFrameHeader = 16;              // len + crc + txid
+constexpr uint32_t kMaxRecord = 64u << 20;       // cota de cordura al leer
+
+bool WriteAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = ::write(fd, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool ReadFile(const std::string& path, std::string* out) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    out->clear();
+    char buf[1 << 16];
+    for (;;) {
+        ssize_t r = ::read(fd, buf, sizeof(buf));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
+        }
+        if (r == 0) break;
+        out->append(buf, static_cast<size_t>(r));
+    }
+    ::close(fd);
+    return true;
+}
+
+}  // namespace
+
+namespace editlog {
+
+bool SyncDir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+}  // namespace editlog
+
+// =============================================
+// SEGMENTOS
+// =============================================
+
+std::string EditLog::SegmentPath(const std::string& dir, uint64_t first_txid) {
+    char name[48];
+    std::snprintf(name, sizeof(name), "edits_%020" PRIu64 ".log", first_txid);
+    return dir + "/" + name;
+}
+
+std::vector<EditLog::Segment> EditLog::ListSegments(const std::string& dir) {
+    std::vector<Segment> out;
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) return out;
+    while (struct dirent* e = ::readdir(d)) {
+        const std::string name = e->d_name;
+        // edits_<20 dígitos>.log
+        if (name.size() != 30 || name.compare(0, 6, "edits_") != 0 ||
+            name.compare(26, 4, ".log") != 0) continue;
+        const std::string digits = name.substr(6, 20);
+        if (!std::all_of(digits.begin(), digits.end(), ::isdigit)) continue;
+        out.push_back({std::stoull(digits), dir + "/" + name});
+    }
+    ::closedir(d);
+    std::sort(out.begin(), out.end(),
+              [](const Segment& a, const Segment& b) { return a.first_txid < b.first_txid; });
+    return out;
+}
+
+EditLog::~EditLog() {
+    Close();
+}
+
+bool EditLog::OpenSegment(uint64_t first_txid) {
+    const std::string path = SegmentPath(dir_, first_txid);
+    // Un segmento con el mismo primer txid solo puede existir sin registros
+    // válidos (Replay ya lo habría entregado), así que se reescribe
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("[EditLog] no se pudo crear " << path << ": " << std::strerror(errno));
+        return false;
+    }
+    if (!WriteAll(fd, kMagic, sizeof(kMagic)) || ::fdatasync(fd) != 0) {
+        LOG_ERROR("[EditLog] error inicializando " << path << ": " << std::strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    editlog::SyncDir(dir_);  // la entrada del directorio también debe ser durable
+    fd_ = fd;
+    segment_first_txid_.store(first_txid);
+    return true;
+}
+
+bool EditLog::Open(const std::string& dir, uint64_t last_txid, const Options& opts) {
+    dir_ = dir;
+    opts_ = opts;
+    if (opts_.max_batch_records == 0) opts_.max_batch_records = 1;
+    last_txid_.store(last_txid);
+    synced_txid_.store(last_txid);
+    written_txid_ = last_txid;
+    if (!OpenSegment(last_txid + 1)) return false;
+    accepting_ = true;
+    writer_ = std::thread(&EditLog::WriterLoop, this);
+    return true;
+}
+
+void EditLog::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stopping_ = true;
+        accepting_ = false;
+    }
+    writer_cv_.notify_one();
+    if (writer_.joinable()) writer_.join();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+// =============================================
+// ESCRITURA (GROUP COMMIT)
+// =============================================
+
+uint64_t EditLog::Append(const std::string& payload) {
+    std::string frame(kFrameHeader + payload.size(), '\0');
+    std::memcpy(&frame[kFrameHeader], payload.data(), payload.size());
+    coding::PutFixed32(&frame[0], static_cast<uint32_t>(8 + payload.size()));
+
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!accepting_) return 0;
+    const uint64_t txid = last_txid_.load() + 1;
+    coding::PutFixed64(&frame[8], txid);
+    coding::PutFixed32(&frame[4], crc32c::Value(&frame[8], 8 + payload.size()));
+
+    if (pending_.empty()) first_pending_time_ = std::chrono::steady_clock::now();
+    pending_bytes_ += frame.size();
+    appended_bytes_.fetch_add(frame.size(), std::memory_order_relaxed);
+    pending_.push_back(std::move(frame));
+    last_txid_.store(txid);
+    writer_cv_.notify_one();
+    return txid;
+}
+
+bool EditLog::Sync(uint64_t txid) {
+    if (synced_txid_.load() >= txid) return true;
+    std::unique_lock<std::mutex> lock(mu_);
+    synced_cv_.wait(lock, [&] { return synced_txid_.load() >= txid || writer_done_; });
+    return synced_txid_.load() >= txid;
+}
+
+bool EditLog::Roll(uint64_t* closed_txid) {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (!accepting_) return false;
+    if (last_txid_.load() + 1 == segment_first_txid_.load()) {
+        // Vacío: nada que cerrar (todo lo anterior está en segmentos cerrados)
+        if (closed_txid) *closed_txid = last_txid_.load();
+        return true;
+    }
+    const uint64_t gen = roll_generation_;
+    roll_requested_ = true;
+    writer_cv_.notify_one();
+    synced_cv_.wait(lock, [&] { return roll_generation_ != gen || writer_done_; });
+    if (roll_generation_ == gen || !roll_ok_) return false;
+    if (closed_txid) *closed_txid = roll_txid_;
+    return true;
+}
+
+bool EditLog::WriteBatch(const std::string& batch) {
+    const off_t before = ::lseek(fd_, 0, SEEK_END);
+    if (!WriteAll(fd_, batch.data(), batch.size())) {
+        LOG_ERROR("[EditLog] error escribiendo lote: " << std::strerror(errno));
+        // No dejar un registro a medias delante de los siguientes
+        if (before >= 0) (void)::ftruncate(fd_, before);
+        return false;
+    }
+    const uint64_t t0 = lockstats::NowNs();
+    if (::fdatasync(fd_) != 0) {
+        LOG_ERROR("[EditLog] fdatasync: " << std::strerror(errno));
+        return false;
+    }
+    fsync_ns_.Add(lockstats::NowNs() - t0);
+    return true;
+}
+
+void EditLog::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    for (;;) {
+        writer_cv_.wait(lock, [&] { return stopping_ || roll_requested_ || !pending_.empty(); });
+        if (pending_.empty() && !roll_requested_) break;  // parada sin pendientes
+
+        // Deja crecer el lote hasta los topes o hasta max_delay
+        auto batch_full = [&] {
+            return stopping_ || roll_requested_ || pending_.size() >= opts_.max_batch_records ||
+                   pending_bytes_ >= opts_.max_batch_bytes;
+        };
+        if (opts_.max_delay.count() > 0 && !batch_full()) {
+            writer_cv_.wait_until(lock, first_pending_time_ + opts_.max_delay, batch_full);
+        }
+
+        // Toma el lote: hasta los topes, o todo lo pendiente si hay que rotar o parar
+        const bool roll = roll_requested_;
+        const bool drain_all = roll || stopping_;
+        std::string batch;
+        size_t n = 0;
+        while (!pending_.empty() &&
+               (drain_all || n == 0 ||
+                (n < opts_.max_batch_records && batch.size() + pending_.front().size() <= opts_.max_batch_bytes))) {
+            batch += pending_.front();
+            pending_.pop_front();
+            ++n;
+        }
+        pending_bytes_ -= batch.size();
+        if (!pending_.empty()) first_pending_time_ = std::chrono::steady_clock::now();
+        const uint64_t first = written_txid_ + 1;
+        const uint64_t last = written_txid_ + n;
+        lock.unlock();
+
+        bool ok = true;
+        if (n > 0) {
+            ok = WriteBatch(batch);
+            if (ok) {
+                written_txid_ = last;
+                batches_.fetch_add(1, std::memory_order_relaxed);
+                batch_records_.fetch_add(n, std::memory_order_relaxed);
+                batch_bytes_.fetch_add(batch.size(), std::memory_order_relaxed);
+                size_t bucket = 0;
+                while (bucket + 1 < kSizeBuckets && (size_t{2} << bucket) <= n) ++bucket;
+                batch_sizes_[bucket].fetch_add(1, std::memory_order_relaxed);
+                uint64_t prev = max_batch_.load(std::memory_order_relaxed);
+                while (n > prev && !max_batch_.compare_exchange_weak(prev, n, std::memory_order_relaxed)) {}
+            }
+        }
+        bool roll_ok = ok;
+        if (roll && ok) {
+            // Todo lo asignado hasta 'last' quedó en el segmento que se cierra
+            ::close(fd_);
+            fd_ = -1;
+            roll_ok = OpenSegment(last + 1);
+        }
+
+        lock.lock();
+        if (!ok) {
+            // Fallo pegajoso: no se escribe nada más, así que synced_txid_ se
+            // queda en el último lote durable y el log nunca tiene huecos. Los
+            // Sync de este lote y de lo pendiente devuelven false.
+            LOG_ERROR("[EditLog] lote txid " << first << "-" << last
+                      << " no escrito; el log queda detenido (reiniciar el NameNode)");
+            failed_ = true;
+        } else if (n > 0) {
+            synced_txid_.store(last);
+        }
+        if (roll) {
+            roll_requested_ = false;
+            roll_ok_ = roll_ok;
+            roll_txid_ = last;
+            ++roll_generation_;
+        }
+        synced_cv_.notify_all();
+        if (!ok || fd_ < 0) break;  // lote fallido o sin segmento nuevo
+    }
+    // Sin escritor no se encolan más registros ni se espera a ninguno
+    accepting_ = false;
+    writer_done_ = true;
+    synced_cv_.notify_all();
+}
+
+void EditLog::Purge(uint64_t covered_txid) {
+    const uint64_t current = segment_first_txid_.load();
+    const std::vector<Segment> segs = ListSegments(dir_);
+    size_t removed = 0;
+    for (size_t i = 0; i + 1 < segs.size(); ++i) {
+        // Los registros del segmento i terminan justo antes del siguiente
+        if (segs[i].first_txid >= current) break;
+        if (segs[i + 1].first_txid - 1 > covered_txid) break;
+        if (::unlink(segs[i].path.c_str()) == 0) ++removed;
+    }
+    if (removed > 0) {
+        editlog::SyncDir(dir_);
+        LOG_INFO("[EditLog] " << removed << " segmentos eliminados (cubiertos hasta txid=" << covered_txid << ")");
+    }
+}
+
+void EditLog::DumpStats(std::ostream& os) const {
+    const uint64_t batches = batches_.load();
+    const uint64_t records = batch_records_.load();
+    os << std::fixed << std::setprecision(1);
+    os << "[EditLog] batches=" << batches << " records=" << records
+       << " bytes=" << batch_bytes_.load()
+       << " avg_batch=" << (batches ? static_cast<double>(records) / batches : 0.0)
+       << " max_batch=" << max_batch_.load();
+    if (failed_.load()) os << " failed=1";
+    if (fsync_ns_.Count() > 0) {
+        os << " fsync_us(p50/p99/max)=" << fsync_ns_.PercentileUs(0.50) << "/"
+           << fsync_ns_.PercentileUs(0.99) << "/" << fsync_ns_.MaxNs() / 1000.0;
+    }
+    os << "\n[EditLog] batch_records:";
+    for (size_t i = 0; i < kSizeBuckets; ++i) {
+        const uint64_t c = batch_sizes_[i].load();
+        if (c == 0) continue;
+        os << " " << (size_t{1} << i) << "-" << ((size_t{2} << i) - 1) << ":" << c;
+    }
+    os << "\n" << std::defaultfloat;
+}
+
+// =============================================
+// RECUPERACIÓN
+// =============================================
+
+namespace {
+
+// ¿Hay en data[from, ...) alguna trama íntegra con txid > after? Si la hay,
+// lo ilegible anterior no es una cola cortada sino corrupción en medio del log.
+bool IntactFrameAfter(const std::string& data, size_t from, uint64_t after) {
+    for (size_t p = from; p + kFrameHeader <= data.size(); ++p) {
+        const uint32_t len = coding::GetFixed32(&data[p]);
+        if (len < 8 || len > kMaxRecord || data.size() - p - 8 < len) continue;
+        // Filtro barato antes del CRC: un txid plausible tras 'after'
+        const uint64_t txid = coding::GetFixed64(&data[p + 8]);
+        if (txid <= after || txid - after > (data.size() - from) / kFrameHeader + 1) continue;
+        if (crc32c::Value(&data[p + 8], len) == coding::GetFixed32(&data[p + 4])) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+bool EditLog::Replay(const std::string& dir, uint64_t after_txid, const ReplayFn& fn, uint64_t* last_txid) {
+    const std::vector<Segment> segs = ListSegments(dir);
+    uint64_t last = after_txid;
+    size_t applied = 0;
+    std::string data;
+
+    for (size_t i = 0; i < segs.size(); ++i) {
+        const bool is_last = (i + 1 == segs.size());
+        // Segmento completamente cubierto por el fsimage
+        if (!is_last && segs[i + 1].first_txid <= after_txid + 1) continue;
+
+        if (!ReadFile(segs[i].path, &data)) {
+            LOG_ERROR("[EditLog] no se pudo leer " << segs[i].path << ": " << std::strerror(errno));
+            return false;
+        }
+
+        size_t off = sizeof(kMagic);
+        const char* why = nullptr;
+        if (data.size() < sizeof(kMagic) || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+            off = 0;
+            why = "cabecera inválida";
+        }
+        while (!why && off < data.size()) {
+            if (data.size() - off < kFrameHeader) { why = "registro incompleto"; break; }
+            const uint32_t len = coding::GetFixed32(&data[off]);
+            const uint32_t crc = coding::GetFixed32(&data[off + 4]);
+            if (len < 8 || len > kMaxRecord) { why = "longitud inválida"; break; }
+            if (data.size() - off - 8 < len) { why = "registro incompleto"; break; }
+            if (crc32c::Value(&data[off + 8], len) != crc) { why = "CRC incorrecto"; break; }
+
+            const uint64_t txid = coding::GetFixed64(&data[off + 8]);
+            if (txid > last) {
+                // El log nunca deja huecos (ver WriterLoop): falta un segmento o
+                // parte de uno
+                if (txid != last + 1) {
+                    LOG_ERROR("[EditLog] hueco de txids: " << last << " -> " << txid << " en " << segs[i].path);
+                    return false;
+                }
+                fn(txid, data.substr(off + kFrameHeader, len - 8));
+                last = txid;
+                ++applied;
+            }
+            off += 8 + len;
+        }
+
+        if (why) {
+            // Solo se tolera la cola del último segmento (escritura cortada por
+            // una caída): un segmento cerrado se sincronizó entero, y tras una
+            // cola cortada no puede haber registros íntegros
+            const size_t resume = off == 0 ? sizeof(kMagic) : off + 1;
+            if (!is_last || IntactFrameAfter(data, resume, last)) {
+                LOG_ERROR("[EditLog] " << segs[i].path << " corrupto en offset " << off << " (" << why
+                          << "); registros íntegros hasta txid=" << last << ", revisar a mano");
+                return false;
+            }
+            LOG_WARN("[EditLog] " << segs[i].path << ": " << why << " en offset " << off << "; se descartan "
+                     << (data.size() - off) << " bytes");
+            const int rc = (off == 0) ? ::unlink(segs[i].path.c_str())
+                                      : ::truncate(segs[i].path.c_str(), static_cast<off_t>(off));
+            if (rc != 0) {
+                LOG_ERROR("[EditLog] no se pudo recortar " << segs[i].path << ": " << std::strerror(errno));
+                return false;
+            }
+            editlog::SyncDir(dir);
+        }
+    }
+
+    if (applied > 0) {
+        LOG_INFO("[EditLog] " << applied << " registros aplicados (txid " << after_txid << " -> " << last << ")");
+    }
+    *last_txid = last;
+    return true;
+}
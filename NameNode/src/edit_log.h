@@ -0,0 +1,160 @@
+#ifndef EDIT_LOG_H
+#define EDIT_LOG_H
+
+#include "lock_stats.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ==============================
+// Edit log (registro de escritura anticipada)
+// ==============================
+//
+// Cada mutación del espacio de nombres se añade como un registro compacto
+// a un segmento "edits_<primer txid>.log" en el directorio de metadatos:
+//
+//   [u32 longitud][u32 crc32c][u64 txid][payload]      (little endian)
+//
+// 'longitud' cuenta txid + payload; el CRC cubre esos mismos bytes. El
+// contenido del payload lo define quien escribe (NameNodeServiceImpl).
+//
+// Escritura agrupada (group commit): Append() solo asigna el txid y encola
+// el registro; un hilo escritor junta lo pendiente de todos los handlers y
+// hace un único write + fdatasync por lote. Sync(txid) espera a que el lote
+// que contiene ese txid esté en disco. Options acota el lote en registros y
+// bytes y cuánto puede esperar el escritor a que se llene.
+//
+// Un error de escritura o de fdatasync es definitivo: el escritor se
+// detiene, Append devuelve 0 y Sync de ese lote en adelante devuelve false
+// (SyncedTxid() nunca pasa de un lote fallido). Así el log no tiene huecos.
+//
+// Al arrancar, Replay() recorre los segmentos en orden y entrega los
+// registros con txid mayor que el del fsimage cargado. Un registro
+// incompleto o con CRC incorrecto al final del último segmento (escritura
+// cortada por una caída) se descarta truncando el archivo. Cualquier otro
+// daño (en un segmento cerrado, con registros íntegros detrás, o un hueco
+// de txids) hace fallar Replay sin tocar nada.
+class EditLog {
+public:
+    struct Options {
+        size_t max_batch_records = 1024;
+        size_t max_batch_bytes = 1 << 20;
+        // Espera máxima desde el primer registro pendiente antes de escribir
+        // (0 = escribir en cuanto el escritor queda libre)
+        std::chrono::microseconds max_delay{0};
+    };
+
+    EditLog() = default;
+    ~EditLog();
+    EditLog(const EditLog&) = delete;
+    EditLog& operator=(const EditLog&) = delete;
+
+    using ReplayFn = std::function<void(uint64_t txid, const std::string& payload)>;
+
+    // Recorre los segmentos de 'dir' entregando registros con txid > after_txid
+    // y deja en 'last_txid' el último aplicado (o after_txid si no hay).
+    // false si el log está dañado más allá de una cola cortada.
+    static bool Replay(const std::string& dir, uint64_t after_txid, const ReplayFn& fn,
+                       uint64_t* last_txid);
+
+    // Abre un segmento nuevo cuyo primer txid será last_txid + 1 y arranca
+    // el escritor
+    bool Open(const std::string& dir, uint64_t last_txid, const Options& opts);
+
+    // Escribe lo pendiente y detiene el escritor (también en el destructor)
+    void Close();
+
+    // Encola un registro y devuelve su txid (0 si el log no está abierto)
+    uint64_t Append(const std::string& payload);
+
+    // Espera a que todo registro <= txid esté en disco (false si el log falló
+    // antes de llegar a él)
+    bool Sync(uint64_t txid);
+
+    // Cierra el segmento actual (tras escribir lo pendiente) y abre otro.
+    // En 'closed_txid' deja el último txid del segmento cerrado: los
+    // registros <= ese txid están escritos y los posteriores van al nuevo.
+    bool Roll(uint64_t* closed_txid = nullptr);
+
+    // Borra los segmentos cuyos registros son todos <= covered_txid
+    // (ya incluidos en un fsimage durable). Nunca borra el actual.
+    void Purge(uint64_t covered_txid);
+
+    uint64_t LastTxid() const { return last_txid_.load(); }
+    uint64_t SyncedTxid() const { return synced_txid_.load(); }
+    // Un lote no se pudo escribir: el log está detenido
+    bool Failed() const { return failed_.load(); }
+    // Bytes encolados desde Open (tramas completas; solo crece)
+    uint64_t AppendedBytes() const { return appended_bytes_.load(std::memory_order_relaxed); }
+
+    // Lotes escritos: tamaño (log2 de registros) y latencia de fdatasync
+    void DumpStats(std::ostream& os) const;
+
+private:
+    struct Segment {
+        uint64_t first_txid;
+        std::string path;
+    };
+    static std::vector<Segment> ListSegments(const std::string& dir);
+    static std::string SegmentPath(const std::string& dir, uint64_t first_txid);
+    bool OpenSegment(uint64_t first_txid);        // hilo escritor (o Open)
+    bool WriteBatch(const std::string& batch);    // hilo escritor
+    void WriterLoop();
+
+    std::string dir_;
+    Options opts_;
+
+    // Solo el hilo escritor (o Open/Close, sin escritor en marcha)
+    int fd_ = -1;
+    uint64_t written_txid_ = 0;                        // último txid escrito en fd_
+    std::atomic<uint64_t> segment_first_txid_{0};
+
+    // Cola de registros pendientes y estado compartido (mu_)
+    std::mutex mu_;
+    std::condition_variable writer_cv_;                // despierta al escritor
+    std::condition_variable synced_cv_;                // despierta a Sync/Roll
+    std::deque<std::string> pending_;                  // tramas con txid consecutivos
+    size_t pending_bytes_ = 0;
+    std::chrono::steady_clock::time_point first_pending_time_;
+    bool roll_requested_ = false;
+    bool roll_ok_ = false;
+    uint64_t roll_txid_ = 0;                           // último txid del segmento cerrado
+    uint64_t roll_generation_ = 0;
+    bool accepting_ = false;                           // Append admite registros
+    bool stopping_ = false;
+    bool writer_done_ = false;
+    std::thread writer_;
+
+    std::atomic<uint64_t> last_txid_{0};    // último txid asignado
+    std::atomic<uint64_t> synced_txid_{0};  // último txid en disco (nunca pasa de un fallo)
+    std::atomic<bool> failed_{false};
+    std::atomic<uint64_t> appended_bytes_{0};
+
+    // Estadísticas de lotes
+    static constexpr size_t kSizeBuckets = 17;          // cubeta i: [2^i, 2^(i+1)) registros
+    std::array<std::atomic<uint64_t>, kSizeBuckets> batch_sizes_{};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> batch_records_{0};
+    std::atomic<uint64_t> batch_bytes_{0};
+    std::atomic<uint64_t> max_batch_{0};
+    lockstats::Histogram fsync_ns_;
+};
+
+namespace editlog {
+
+// fsync del directorio (hace durables creaciones, renombres y borrados)
+bool SyncDir(const std::string& dir);
+
+}  // namespace editlog
+
+#endif // EDIT_LOG_H
@@ -0,0 +1,158 @@
+#include "file_map.h"
+
+#include <atomic>
+#include <functional>
+#include <utility>
+
+namespace {
+
+// Posición (bit) de un hash en el nodo de nivel 'shift'
+uint32_t BitOf(uint64_t hash, unsigned shift) {
+    return 1u << ((hash >> shift) & 31);
+}
+
+// Índice en el vector del nodo de la posición 'bit' según su mapa
+size_t IndexOf(uint32_t map, uint32_t bit) {
+    return static_cast<size_t>(__builtin_popcount(map & (bit - 1)));
+}
+
+}  // namespace
+
+FileMap::FileMap() : root_(std::make_shared<Node>()), edit_(NewEdit()) {
+    root_->edit = edit_;
+}
+
+FileMap::FileMap(const FileMap& other) : root_(other.root_), edit_(NewEdit()), size_(other.size_) {}
+
+FileMap& FileMap::operator=(const FileMap& other) {
+    root_ = other.root_;
+    edit_ = NewEdit();
+    size_ = other.size_;
+    return *this;
+}
+
+uint64_t FileMap::Hash(const std::string& key) {
+    return static_cast<uint64_t>(std::hash<std::string>{}(key));
+}
+
+uint64_t FileMap::NewEdit() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+FileMap::Node* FileMap::Mutable(std::shared_ptr<Node>& slot) {
+    if (slot->edit != edit_) {
+        slot = std::make_shared<Node>(*slot);
+        slot->edit = edit_;
+    }
+    return slot.get();
+}
+
+const FileMetadata* FileMap::Find(const std::string& key) const {
+    const uint64_t h = Hash(key);
+    const Node* node = root_.get();
+    for (unsigned shift = 0;; shift += kBits) {
+        if (shift >= kHashBits) {
+            for (const Entry& e : node->entries) {
+                if (e.key == key) return e.value.get();
+            }
+            return nullptr;
+        }
+        const uint32_t bit = BitOf(h, shift);
+        if (node->entry_map & bit) {
+            const Entry& e = node->entries[IndexOf(node->entry_map, bit)];
+            return e.hash == h && e.key == key ? e.value.get() : nullptr;
+        }
+        if (!(node->child_map & bit)) return nullptr;
+        node = node->children[IndexOf(node->child_map, bit)].get();
+    }
+}
+
+bool FileMap::Put(std::string key, Value value) {
+    const uint64_t h = Hash(key);
+    Node* node = Mutable(root_);
+    for (unsigned shift = 0;; shift += kBits) {
+        if (shift >= kHashBits) {
+            for (Entry& e : node->entries) {
+                if (e.key == key) {
+                    e.value = std::move(value);
+                    return false;
+                }
+            }
+            node->entries.push_back({h, std::move(key), std::move(value)});
+            ++size_;
+            return true;
+        }
+        const uint32_t bit = BitOf(h, shift);
+        if (node->child_map & bit) {
+            node = Mutable(node->children[IndexOf(node->child_map, bit)]);
+            continue;
+        }
+        const size_t idx = IndexOf(node->entry_map, bit);
+        if (!(node->entry_map & bit)) {
+            node->entries.insert(node->entries.begin() + idx, Entry{h, std::move(key), std::move(value)});
+            node->entry_map |= bit;
+            ++size_;
+            return true;
+        }
+        Entry& e = node->entries[idx];
+        if (e.hash == h && e.key == key) {
+            e.value = std::move(value);
+            return false;
+        }
+        // Dos claves en la misma posición: la que había baja a un subnodo
+        // nuevo y la nueva sigue bajando desde él
+        auto child = std::make_shared<Node>();
+        child->edit = edit_;
+        const unsigned next = shift + kBits;
+        if (next < kHashBits) child->entry_map = BitOf(e.hash, next);
+        child->entries.push_back(std::move(e));
+        node->entries.erase(node->entries.begin() + idx);
+        node->entry_map &= ~bit;
+        Node* raw = child.get();
+        node->children.insert(node->children.begin() + IndexOf(node->child_map, bit), std::move(child));
+        node->child_map |= bit;
+        node = raw;
+    }
+}
+
+bool FileMap::Erase(const std::string& key) {
+    // Sin copiar el camino si la clave no está
+    if (Find(key) == nullptr) return false;
+    EraseIn(*Mutable(root_), Hash(key), key, 0);
+    --size_;
+    return true;
+}
+
+bool FileMap::EraseIn(Node& node, uint64_t hash, const std::string& key, unsigned shift) {
+    if (shift >= kHashBits) {
+        for (size_t i = 0; i < node.entries.size(); ++i) {
+            if (node.entries[i].key != key) continue;
+            node.entries.erase(node.entries.begin() + i);
+            return true;
+        }
+        return false;
+    }
+    const uint32_t bit = BitOf(hash, shift);
+    if (node.entry_map & bit) {
+        const size_t idx = IndexOf(node.entry_map, bit);
+        if (node.entries[idx].hash != hash || node.entries[idx].key != key) return false;
+        node.entries.erase(node.entries.begin() + idx);
+        node.entry_map &= ~bit;
+        return true;
+    }
+    if (!(node.child_map & bit)) return false;
+    const size_t ci = IndexOf(node.child_map, bit);
+    Node& child = *Mutable(node.children[ci]);
+    if (!EraseIn(child, hash, key, shift + kBits)) return false;
+    // Un subnodo con una sola entrada vuelve a esta posición: el trie
+    // queda igual que si esa clave se hubiera insertado sola
+    if (child.child_map == 0 && child.entries.size() == 1) {
+        Entry last = std::move(child.entries.front());
+        node.children.erase(node.children.begin() + ci);
+        node.child_map &= ~bit;
+        node.entries.insert(node.entries.begin() + IndexOf(node.entry_map, bit), std::move(last));
+        node.entry_map |= bit;
+    }
+    return true;
+}
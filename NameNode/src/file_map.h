@@ -0,0 +1,90 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include "metadata.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ==============================
+// Mapa persistente de archivos
+// ==============================
+//
+// file_key ("user_id:filename") -> FileMetadata de una versión de
+// partición (ShardVersion::files). Es un trie por el hash de la clave
+// (HAMT): cada nodo reparte 5 bits del hash en 32 posiciones, cada una con
+// una entrada o un subnodo. Copiar el mapa comparte todos los nodos; una
+// escritura copia solo el camino hasta su clave, O(log32 n) nodos de hasta
+// 32 posiciones, sea cual sea el tamaño de la partición.
+//
+// Cada copia del mapa recibe un permiso de escritura propio ('edit_') y lo
+// graba en los nodos que copia: las escrituras siguientes de la misma copia
+// los modifican en su sitio, así que una serie de escrituras sobre una
+// versión (BlockReport, carga diferida, replay) copia cada nodo como mucho
+// una vez.
+//
+// Inmutable tras publicarse: Put y Erase solo sobre copias aún no
+// publicadas, y no sobre un mapa del que ya se ha sacado otra copia.
+class FileMap {
+public:
+    using Value = std::shared_ptr<const FileMetadata>;
+
+    FileMap();  // mapa vacío
+    FileMap(const FileMap& other);
+    FileMap& operator=(const FileMap& other);
+    FileMap(FileMap&&) noexcept = default;
+    FileMap& operator=(FileMap&&) noexcept = default;
+
+    size_t size() const { return size_; }
+    const FileMetadata* Find(const std::string& key) const;
+
+    // true si la clave es nueva (si no, reemplaza su valor)
+    bool Put(std::string key, Value value);
+    // true si la clave estaba
+    bool Erase(const std::string& key);
+
+    // fn(const std::string& key, const Value& value) para cada archivo, sin
+    // orden definido; las referencias valen mientras viva esta versión
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        ForEachIn(*root_, fn);
+    }
+
+private:
+    static constexpr unsigned kBits = 5;       // posiciones por nodo: 32
+    static constexpr unsigned kHashBits = 64;  // a partir de aquí, nodo de colisiones
+
+    struct Entry {
+        uint64_t hash;
+        std::string key;
+        Value value;
+    };
+    struct Node {
+        uint64_t edit = 0;        // copia del mapa que puede modificarlo en su sitio
+        uint32_t entry_map = 0;   // posiciones con una entrada
+        uint32_t child_map = 0;   // posiciones con un subnodo
+        std::vector<Entry> entries;                  // en orden de posición (colisiones: sin orden)
+        std::vector<std::shared_ptr<Node>> children;  // en orden de posición
+    };
+
+    static uint64_t Hash(const std::string& key);
+    static uint64_t NewEdit();
+
+    // El nodo de 'slot', copiado antes si no es de esta copia del mapa
+    Node* Mutable(std::shared_ptr<Node>& slot);
+    bool EraseIn(Node& node, uint64_t hash, const std::string& key, unsigned shift);
+
+    template <typename Fn>
+    static void ForEachIn(const Node& node, Fn& fn) {
+        for (const Entry& e : node.entries) fn(e.key, e.value);
+        for (const auto& child : node.children) ForEachIn(*child, fn);
+    }
+
+    std::shared_ptr<Node> root_;
+    uint64_t edit_;
+    size_t size_ = 0;
+};
+
+#endif // FILE_MAP_H
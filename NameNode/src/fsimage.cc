@@ -0,0 +1,1121 @@
+#include "fsimage.h"
+#include "coding.h"
+#include "crc32c.h"
+
+#include "zstd/zstd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace fsimage {
+namespace {
+
+constexpr char kMagic[8] = {'G', 'D', 'F', 'S', 'I', 'M', 'G', '\0'};
+constexpr uint32_t kVersion = 4;
+constexpr size_t kHeaderSize = 32;
+constexpr size_t kSectionEntrySizeV2 = 32;  // versiones 1 y 2 (sin códec)
+constexpr size_t kSectionEntrySize = 48;     // versiones 3 y 4
+constexpr size_t kTableCrcOffset = 28;      // u32 de la cabecera (versión 4)
+constexpr uint32_t kMaxSections = 1 << 16;
+constexpr uint32_t kMaxPartitions = (kMaxSections - 2) / 3;
+
+// Bytes sin comprimir que se acumulan antes de pasarlos al compresor, y
+// tamaño en que crece la ventana de lectura al descomprimir
+constexpr size_t kChunk = 256 << 10;
+
+enum SectionType : uint32_t {
+    kUsers = 1,      // user_id, username, password_hash, created_ms
+    kDataNodes = 2,  // datanode_id, address
+    kDirs = 3,       // ref usuario, path
+    kFiles = 4,      // ref usuario, nombre, flags, ... , bloques
+    kUserParts = 5,  // partición de cada usuario, en el orden de USERS
+};
+
+enum Codec : uint32_t {
+    kCodecNone = 0,
+    kCodecZstd = 1,  // la sección es un frame zstd
+};
+
+// Flags por archivo (FILES)
+constexpr uint64_t kFilenameIsKey = 1;    // filename == parte de la clave tras "user_id:"
+constexpr uint64_t kOwnerIsKeyUser = 2;   // owner_id == user_id de la clave
+constexpr uint64_t kDefaultBlockIds = 4;  // todos los block_id son <user>_<filename>_blk_<i>
+
+struct SectionEntry {
+    uint32_t type = 0;
+    uint32_t part = 0;
+    uint64_t offset = 0;
+    uint64_t length = 0;      // bytes en el archivo
+    uint64_t count = 0;
+    uint64_t raw_length = 0;  // bytes sin comprimir
+    uint32_t codec = kCodecNone;
+    uint32_t crc = 0;         // CRC32C de los bytes en el archivo
+    bool has_crc = false;     // versión >= 4
+};
+
+// Referencia de un usuario: índice + 1 en USERS (0 = clave literal)
+using UserRefs = std::unordered_map<std::string_view, uint64_t>;
+
+// "user_id:resto" -> (user_id, resto); sin ':' el usuario queda vacío
+void SplitKey(const std::string& key, std::string_view* user, std::string_view* rest) {
+    const size_t c = key.find(':');
+    if (c == std::string::npos) {
+        *user = std::string_view();
+        *rest = key;
+    } else {
+        *user = std::string_view(key).substr(0, c);
+        *rest = std::string_view(key).substr(c + 1);
+    }
+}
+
+int64_t ToMillis(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+}
+
+std::chrono::system_clock::time_point FromMillis(int64_t ms) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
+}
+
+bool PWriteAll(int fd, const char* p, size_t n, uint64_t offset) {
+    while (n > 0) {
+        ssize_t w = ::pwrite(fd, p, n, static_cast<off_t>(offset));
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += w;
+        n -= static_cast<size_t>(w);
+        offset += static_cast<uint64_t>(w);
+    }
+    return true;
+}
+
+// CRC32C de la cabecera (sin el propio campo) y de la tabla de secciones
+uint32_t TableCrc(const char* data, size_t n) {
+    return crc32c::Extend(crc32c::Value(data, kTableCrcOffset), data + kHeaderSize, n - kHeaderSize);
+}
+
+}  // namespace
+
+// =============================================
+// ESCRITURA
+// =============================================
+
+namespace {
+
+struct CCtxDeleter {
+    void operator()(ZSTD_CCtx* c) const { ZSTD_freeCCtx(c); }
+};
+using CCtxPtr = std::unique_ptr<ZSTD_CCtx, CCtxDeleter>;
+
+// Una sección en construcción. Las entradas se codifican en 'raw'; con
+// compresión, cada kChunk bytes pasan al compresor y solo se conserva la
+// salida comprimida ('out'), que es lo que se escribe en el archivo.
+class SectionWriter {
+public:
+    SectionWriter(uint32_t type, uint32_t part) { entry_.type = type; entry_.part = part; }
+
+    // level <= 0: sin comprimir. Cada sección tiene su contexto: las de
+    // una partición se rellenan a la vez (DATANODES junto con FILES).
+    void Start(int level) {
+        if (level <= 0) return;
+        cctx_.reset(ZSTD_createCCtx());
+        ZSTD_CCtx_setParameter(cctx_.get(), ZSTD_c_compressionLevel, level);
+        entry_.codec = kCodecZstd;
+    }
+    coding::Encoder& raw() { return raw_; }
+    void EndEntry() {
+        ++entry_.count;
+        if (cctx_ && raw_.data().size() >= kChunk) {
+            Compress(ZSTD_e_continue);
+            raw_.data().clear();
+        }
+    }
+    bool Finish(std::string* err) {
+        if (cctx_) {
+            // Una sección que cabe en un bloque y no se reduce va sin comprimir
+            const bool single = entry_.raw_length == 0;
+            Compress(ZSTD_e_end);
+            if (!error_.empty()) {
+                *err = error_;
+                return false;
+            }
+            if (!single || out_.size() < raw_.data().size()) {
+                raw_.data().clear();
+                entry_.crc = crc32c::Value(out_.data(), out_.size());
+                return true;
+            }
+            entry_.codec = kCodecNone;
+        }
+        entry_.raw_length = raw_.data().size();
+        out_ = raw_.Release();
+        entry_.crc = crc32c::Value(out_.data(), out_.size());
+        return true;
+    }
+
+    uint64_t count() const { return entry_.count; }
+    uint64_t raw_length() const { return entry_.raw_length; }
+    const std::string& out() const { return out_; }
+    void Free() { std::string().swap(out_); }
+
+    // Fija la posición en el archivo y devuelve la entrada de la tabla
+    SectionEntry Place(uint64_t offset) {
+        entry_.offset = offset;
+        entry_.length = out_.size();
+        return entry_;
+    }
+
+private:
+    void Compress(ZSTD_EndDirective mode) {
+        const std::string& in = raw_.data();
+        entry_.raw_length += in.size();
+        ZSTD_inBuffer src{in.data(), in.size(), 0};
+        for (;;) {
+            const size_t used = out_.size();
+            out_.resize(used + ZSTD_CStreamOutSize());
+            ZSTD_outBuffer dst{&out_[0], out_.size(), used};
+            const size_t r = ZSTD_compressStream2(cctx_.get(), &dst, &src, mode);
+            out_.resize(dst.pos);
+            if (ZSTD_isError(r)) {
+                error_ = std::string("zstd: ") + ZSTD_getErrorName(r);
+                break;
+            }
+            // continue: hasta consumir la entrada; end: hasta cerrar el frame
+            if (mode == ZSTD_e_continue ? src.pos == src.size : r == 0) break;
+        }
+    }
+
+    SectionEntry entry_;
+    CCtxPtr cctx_;
+    coding::Encoder raw_;
+    std::string out_;
+    std::string error_;
+};
+
+// DATANODES, DIRS y FILES de una partición (solo lee 'user_ref'). Sin
+// 'names' cada bloque se guarda con 0 réplicas y DATANODES queda vacía.
+void EncodePartition(const ImageView::Partition& part, const UserRefs& user_ref, const DataNodeNames* names,
+                     SectionWriter& datanodes, SectionWriter& dirs, SectionWriter& files) {
+    auto ref_of = [&](std::string_view user) -> uint64_t {
+        auto it = user_ref.find(user);
+        return it == user_ref.end() ? 0 : it->second;
+    };
+
+    for (const std::string* key : part.directories) {
+        std::string_view user, rest;
+        SplitKey(*key, &user, &rest);
+        const uint64_t ref = user.empty() ? 0 : ref_of(user);
+        dirs.raw().PutVarint(ref);
+        dirs.raw().PutString(ref ? std::string(rest) : *key);
+        dirs.EndEntry();
+    }
+
+    // Réplicas: índice en la tabla de pares (datanode_id, address)
+    std::unordered_map<NodeIndex, uint64_t> dn_index;
+    std::string dn_id, dn_addr;
+    for (const ImageView::File& f : part.files) {
+        const FileMetadata& fm = *f.meta;
+        std::string_view user, rest;
+        SplitKey(*f.key, &user, &rest);
+        const uint64_t ref = user.empty() ? 0 : ref_of(user);
+
+        uint64_t flags = 0;
+        if (fm.FilenameIs(rest)) flags |= kFilenameIsKey;
+        if (ref != 0 && fm.owner_id() == user) flags |= kOwnerIsKeyUser;
+        // El block_id por defecto en memoria usa owner_id y el del formato el
+        // usuario de la clave: coinciden si el propietario es ese usuario
+        bool default_ids = (flags & kOwnerIsKeyUser) != 0;
+        for (size_t i = 0; default_ids && i < fm.blocks.size(); ++i) default_ids = fm.blocks[i].id.empty();
+        if (default_ids) flags |= kDefaultBlockIds;
+
+        coding::Encoder& e = files.raw();
+        e.PutVarint(ref);
+        e.PutString(ref ? std::string(rest) : *f.key);
+        e.PutVarint(flags);
+        if (!(flags & kFilenameIsKey)) e.PutString(fm.filename());
+        if (!(flags & kOwnerIsKeyUser)) {
+            const uint64_t owner = ref_of(fm.owner_id());
+            e.PutVarint(owner);
+            if (owner == 0) e.PutString(fm.owner_id());
+        }
+        e.PutSigned(fm.size);
+        e.PutSigned(ToMillis(fm.created_time));
+        e.PutVarint(fm.blocks.size());
+        for (size_t i = 0; i < fm.blocks.size(); ++i) {
+            const BlockMeta& b = fm.blocks[i];
+            if (!(flags & kDefaultBlockIds)) e.PutString(fm.BlockId(i));
+            e.PutSigned(b.size);
+            if (names == nullptr) {
+                e.PutVarint(0);
+                continue;
+            }
+            e.PutVarint(b.replicas.size());
+            for (NodeIndex node : b.replicas) {
+                auto ins = dn_index.emplace(node, datanodes.count());
+                if (ins.second) {
+                    names->Lookup(node, &dn_id, &dn_addr);
+                    datanodes.raw().PutString(dn_id);
+                    datanodes.raw().PutString(dn_addr);
+                    datanodes.EndEntry();
+                }
+                e.PutVarint(ins.first->second);
+            }
+        }
+        files.EndEntry();
+    }
+}
+
+}  // namespace
+
+bool WriteBinary(const ImageView& image, int fd, const WriteOptions& opts, WriteStats* stats, std::string* err) {
+    const uint32_t nparts = static_cast<uint32_t>(image.partitions.size());
+    if (nparts == 0 || nparts > kMaxPartitions) {
+        *err = "número de particiones inválido: " + std::to_string(nparts);
+        return false;
+    }
+    // La tabla ocupa el hueco de todas las secciones posibles; las vacías
+    // no se escriben y su hueco queda sin usar
+    const uint64_t max_sections = 2 + 3 * static_cast<uint64_t>(nparts);
+    uint64_t offset = kHeaderSize + kSectionEntrySize * max_sections;
+    std::vector<SectionEntry> table;
+    table.reserve(max_sections);
+    uint64_t raw_bytes = 0;
+
+    // Tabla de usuarios, común a todas las particiones
+    UserRefs user_ref;
+    user_ref.reserve(image.users.size());
+    {
+        SectionWriter users(kUsers, 0);
+        users.Start(opts.zstd_level);
+        for (const UserInfo* u : image.users) {
+            users.raw().PutString(u->user_id);
+            users.raw().PutString(u->username);
+            users.raw().PutString(u->password_hash);
+            users.raw().PutSigned(ToMillis(u->created_time));
+            users.EndEntry();
+            user_ref.emplace(u->user_id, users.count());
+        }
+        if (!users.Finish(err)) return false;
+        if (!PWriteAll(fd, users.out().data(), users.out().size(), offset)) {
+            *err = std::string("write: ") + std::strerror(errno);
+            return false;
+        }
+        table.push_back(users.Place(offset));
+        offset += users.out().size();
+        raw_bytes += users.raw_length();
+    }
+    if (!image.user_partitions.empty()) {
+        SectionWriter index(kUserParts, 0);
+        index.Start(opts.zstd_level);
+        for (uint32_t part : image.user_partitions) {
+            index.raw().PutVarint(part);
+            index.EndEntry();
+        }
+        if (!index.Finish(err)) return false;
+        if (!PWriteAll(fd, index.out().data(), index.out().size(), offset)) {
+            *err = std::string("write: ") + std::strerror(errno);
+            return false;
+        }
+        table.push_back(index.Place(offset));
+        offset += index.out().size();
+        raw_bytes += index.raw_length();
+    }
+
+    // Particiones: se codifican en paralelo y se escriben en orden en cuanto
+    // termina cada una (la memoria es la de las particiones en curso)
+    std::mutex mu;
+    std::condition_variable turn_cv;
+    uint32_t next_to_write = 0;
+    std::string write_err;
+    ParallelFor(nparts, opts.threads, [&](size_t p) {
+        SectionWriter sections[3] = {{kDataNodes, static_cast<uint32_t>(p)},
+                                     {kDirs, static_cast<uint32_t>(p)},
+                                     {kFiles, static_cast<uint32_t>(p)}};
+        for (auto& s : sections) s.Start(opts.zstd_level);
+        EncodePartition(image.partitions[p], user_ref, opts.locations ? image.datanodes : nullptr,
+                        sections[0], sections[1], sections[2]);
+        std::string local_err;
+        for (auto& s : sections) {
+            if (!s.Finish(&local_err)) break;
+        }
+
+        std::unique_lock<std::mutex> lock(mu);
+        turn_cv.wait(lock, [&] { return next_to_write == p; });
+        if (write_err.empty() && !local_err.empty()) write_err = local_err;
+        for (auto& s : sections) {
+            if (!write_err.empty() || s.count() == 0) continue;  // una partición vacía no ocupa nada
+            if (!PWriteAll(fd, s.out().data(), s.out().size(), offset)) {
+                write_err = std::string("write: ") + std::strerror(errno);
+                continue;
+            }
+            table.push_back(s.Place(offset));
+            offset += s.out().size();
+            raw_bytes += s.raw_length();
+            s.Free();
+        }
+        ++next_to_write;
+        turn_cv.notify_all();
+    });
+    if (!write_err.empty()) {
+        *err = write_err;
+        return false;
+    }
+
+    // Cabecera + tabla, al principio del archivo
+    coding::Encoder head;
+    head.data().append(kMagic, sizeof(kMagic));
+    head.PutFixed32(kVersion);
+    head.PutFixed32(static_cast<uint32_t>(table.size()));
+    head.PutFixed64(image.txid);
+    head.PutFixed32(nparts);
+    head.PutFixed32(0);
+    for (const SectionEntry& s : table) {
+        head.PutFixed32(s.type);
+        head.PutFixed32(s.part);
+        head.PutFixed64(s.offset);
+        head.PutFixed64(s.length);
+        head.PutFixed64(s.count);
+        head.PutFixed64(s.raw_length);
+        head.PutFixed32(s.codec);
+        head.PutFixed32(s.crc);
+    }
+    coding::PutFixed32(&head.data()[kTableCrcOffset], TableCrc(head.data().data(), head.data().size()));
+    head.data().resize(kHeaderSize + kSectionEntrySize * max_sections, '\0');
+    if (!PWriteAll(fd, head.data().data(), head.data().size(), 0)) {
+        *err = std::string("write: ") + std::strerror(errno);
+        return false;
+    }
+    if (stats) {
+        stats->raw_bytes = raw_bytes;
+        stats->file_bytes = offset;
+    }
+    return true;
+}
+
+void WriteText(const ImageView& image, std::ostream& out) {
+    out << "SEQ\t1\n";
+    out << "TXID\t" << image.txid << "\n";
+    for (const UserInfo* u : image.users) {
+        out << "USER\t" << u->user_id << "\t" << u->username << "\t"
+            << u->password_hash << "\t" << ToMillis(u->created_time) << "\n";
+    }
+    for (const ImageView::Partition& part : image.partitions) {
+        for (const std::string* d : part.directories) out << "DIR\t" << *d << "\n";
+    }
+    std::string dn_id, dn_addr;
+    for (const ImageView::Partition& part : image.partitions) {
+        for (const ImageView::File& f : part.files) {
+            const FileMetadata& fm = *f.meta;
+            out << "FILE\t" << *f.key << "\t" << fm.owner_id() << "\t"
+                << fm.size << "\t" << ToMillis(fm.created_time) << "\t" << fm.filename() << "\n";
+            for (size_t idx = 0; idx < fm.blocks.size(); ++idx) {
+                const BlockMeta& b = fm.blocks[idx];
+                const std::string block_id = fm.BlockId(idx);
+                out << "BLK\t" << *f.key << "\t" << block_id << "\t"
+                    << idx << "\t" << b.size << "\n";
+                for (NodeIndex node : b.replicas) {
+                    if (image.datanodes == nullptr) break;
+                    image.datanodes->Lookup(node, &dn_id, &dn_addr);
+                    out << "LOC\t" << block_id << "\t" << dn_id << "\t" << dn_addr << "\n";
+                }
+            }
+        }
+    }
+}
+
+// =============================================
+// LECTURA
+// =============================================
+
+MappedFile::~MappedFile() {
+    if (map_ != nullptr) ::munmap(map_, size_);
+}
+
+bool MappedFile::Open(const std::string& path, std::string* err) {
+    err->clear();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) *err = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        *err = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ > 0) {
+        map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_ == MAP_FAILED) {
+            map_ = nullptr;
+            size_ = 0;
+            *err = path + ": mmap: " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        ::madvise(map_, size_, MADV_SEQUENTIAL);  // se lee una vez, de principio a fin
+        data_ = static_cast<const char*>(map_);
+    }
+    ::close(fd);
+    return true;
+}
+
+bool IsBinary(const char* data, size_t n) {
+    return n >= sizeof(kMagic) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+namespace {
+
+// Bytes de una sección por ventanas. Sin comprimir, la ventana es la
+// sección entera (vista sobre el archivo); con zstd, More() descomprime
+// kChunk bytes más detrás de lo que aún no se ha consumido.
+class SectionInput {
+public:
+    SectionInput(const char* file, const SectionEntry& s) : entry_(s) {
+        if (s.codec == kCodecNone) {
+            window_ = file + s.offset;
+            size_ = s.length;
+        } else {
+            dctx_ = ZSTD_createDCtx();
+            in_ = ZSTD_inBuffer{file + s.offset, s.length, 0};
+        }
+    }
+    ~SectionInput() {
+        if (dctx_) ZSTD_freeDCtx(dctx_);
+    }
+    SectionInput(const SectionInput&) = delete;
+    SectionInput& operator=(const SectionInput&) = delete;
+
+    const char* data() const { return window_; }
+    size_t size() const { return size_; }
+    void Consume(size_t n) {
+        window_ += n;
+        size_ -= n;
+    }
+
+    // Amplía la ventana; false si la sección se acabó (con 'err' si además
+    // el frame está incompleto o no cuadra con la longitud declarada)
+    bool More(std::string* err) {
+        if (dctx_ == nullptr || frame_done_) return false;
+        // Lo no consumido pasa al principio del búfer
+        const size_t keep = size_;
+        std::memmove(&buf_[0], window_, keep);
+        buf_.resize(keep + kChunk);
+        ZSTD_outBuffer out{&buf_[0], buf_.size(), keep};
+        while (out.pos == keep) {
+            const size_t consumed = in_.pos;
+            const size_t r = ZSTD_decompressStream(dctx_, &out, &in_);
+            if (ZSTD_isError(r)) {
+                *err = std::string("zstd: ") + ZSTD_getErrorName(r);
+                return false;
+            }
+            if (r == 0) {
+                frame_done_ = true;
+                break;
+            }
+            if (out.pos == keep && in_.pos == consumed) {
+                *err = "frame zstd incompleto";
+                return false;
+            }
+        }
+        produced_ += out.pos - keep;
+        buf_.resize(out.pos);
+        window_ = buf_.data();
+        size_ = buf_.size();
+        if (produced_ > entry_.raw_length || (frame_done_ && produced_ != entry_.raw_length)) {
+            *err = "longitud descomprimida inválida";
+            return false;
+        }
+        return out.pos > keep;
+    }
+
+    // Toda la sección en la ventana (para las tablas de cadenas)
+    bool ReadAll(std::string* err) {
+        while (More(err)) {
+        }
+        return err->empty();
+    }
+
+    // No queda nada: ni en la ventana ni por descomprimir
+    bool Finished(std::string* err) {
+        if (size_ != 0) return false;
+        if (dctx_ == nullptr) return true;
+        return !More(err) && err->empty() && frame_done_ && in_.pos == in_.size;
+    }
+
+private:
+    SectionEntry entry_;
+    const char* window_ = "";
+    size_t size_ = 0;
+    ZSTD_DCtx* dctx_ = nullptr;
+    ZSTD_inBuffer in_{nullptr, 0, 0};
+    std::string buf_;
+    uint64_t produced_ = 0;
+    bool frame_done_ = false;
+};
+
+// Resultado de decodificar una entrada desde una ventana
+enum class Parse { kOk, kShort, kBad };
+
+// Estado de lectura de una partición: su tabla de DataNodes y la tabla de
+// usuarios común, ya completa. Las vistas apuntan al archivo o a los
+// búferes descomprimidos que se guardan aquí.
+struct PartitionReader {
+    uint32_t part = 0;
+    DataNodeNames* names = nullptr;  // ImageSink::DataNodes (nullptr: réplicas descartadas)
+    const std::vector<std::string_view>* user_ids = nullptr;
+    std::vector<NodeIndex> dns;                         // DATANODES, ya como NodeIndex
+    std::vector<std::unique_ptr<SectionInput>> tables;  // mantiene vivas las vistas
+    mutable std::vector<symbols::Ref> user_syms;        // por ref - 1; vacío = aún no internado
+
+    bool UserFor(uint64_t ref, std::string_view* user) const {
+        if (ref == 0 || ref > user_ids->size()) return false;
+        *user = (*user_ids)[ref - 1];
+        return true;
+    }
+
+    // Símbolo de un ref válido (vacío si es 0): cada usuario se interna una vez por partición
+    const symbols::Ref& UserSymbol(uint64_t ref) const {
+        static const symbols::Ref kNone;
+        if (ref == 0) return kNone;
+        if (user_syms.size() < ref) user_syms.resize(user_ids->size());
+        symbols::Ref& s = user_syms[ref - 1];
+        if (s.empty()) s = symbols::Intern((*user_ids)[ref - 1]);
+        return s;
+    }
+};
+
+Parse DecodeDir(coding::Decoder& d, const PartitionReader& r, std::string* key, const char** what) {
+    uint64_t ref;
+    std::string_view rest, user;
+    if (!d.GetVarint(&ref) || !d.GetStringView(&rest)) return Parse::kShort;
+    key->clear();
+    if (ref != 0) {
+        if (!r.UserFor(ref, &user)) {
+            *what = "referencia de usuario inválida";
+            return Parse::kBad;
+        }
+        key->reserve(user.size() + 1 + rest.size());
+        key->append(user).append(1, ':');
+    }
+    key->append(rest);
+    return Parse::kOk;
+}
+
+Parse DecodeFile(coding::Decoder& d, const PartitionReader& r, std::string* key, FileMetadata* fm,
+                 const char** what) {
+    auto bad = [&](const char* w) {
+        *what = w;
+        return Parse::kBad;
+    };
+    uint64_t ref, flags, nblocks;
+    std::string_view rest, user;
+    if (!d.GetVarint(&ref) || !d.GetStringView(&rest) || !d.GetVarint(&flags)) return Parse::kShort;
+    key->clear();
+    if (ref != 0) {
+        if (!r.UserFor(ref, &user)) return bad("referencia de usuario inválida");
+        key->reserve(user.size() + 1 + rest.size());
+        key->append(user).append(1, ':');
+    }
+    key->append(rest);
+
+    if (flags & kFilenameIsKey) {
+        fm->SetFilename(rest);
+    } else {
+        std::string_view name;
+        if (!d.GetStringView(&name)) return Parse::kShort;
+        fm->SetFilename(name);
+    }
+    if (flags & kOwnerIsKeyUser) {
+        fm->owner = r.UserSymbol(ref);
+    } else {
+        uint64_t owner;
+        std::string_view owner_id;
+        if (!d.GetVarint(&owner)) return Parse::kShort;
+        if (owner == 0) {
+            if (!d.GetStringView(&owner_id)) return Parse::kShort;
+            fm->SetOwner(owner_id);
+        } else if (!r.UserFor(owner, &owner_id)) {
+            return bad("referencia de usuario inválida");
+        } else {
+            fm->owner = r.UserSymbol(owner);
+        }
+    }
+    int64_t ms;
+    if (!d.GetSigned(&fm->size) || !d.GetSigned(&ms) || !d.GetVarint(&nblocks)) return Parse::kShort;
+    // Cada bloque ocupa al menos un byte: si no caben, falta ventana (o la
+    // cifra es inválida, lo que se ve al llegar al final de la sección)
+    if (nblocks > d.remaining()) return Parse::kShort;
+    fm->created_time = FromMillis(ms);
+    fm->blocks.resize(nblocks);
+    // <user>_<filename>_blk_<i> es también el block_id por defecto en memoria
+    // si el propietario es el usuario de la clave: no hay nada que guardar
+    const bool implicit_ids = (flags & kDefaultBlockIds) && ref != 0 && fm->owner == r.UserSymbol(ref);
+    std::string default_id;
+    for (uint64_t b = 0; b < nblocks; ++b) {
+        BlockMeta& bm = fm->blocks[b];
+        if (flags & kDefaultBlockIds) {
+            if (!implicit_ids) {
+                const std::string idx = std::to_string(b);
+                const std::string filename = fm->filename();
+                default_id.clear();
+                default_id.append(user).append(1, '_').append(filename).append("_blk_").append(idx);
+                fm->SetBlockId(b, default_id);
+            }
+        } else {
+            std::string_view id;
+            if (!d.GetStringView(&id)) return Parse::kShort;
+            fm->SetBlockId(b, id);
+        }
+        int64_t sz;
+        uint64_t nlocs;
+        if (!d.GetSigned(&sz) || !d.GetVarint(&nlocs)) return Parse::kShort;
+        if (nlocs > d.remaining()) return Parse::kShort;
+        bm.size = sz;
+        if (r.names != nullptr) bm.replicas.reserve(nlocs);
+        for (uint64_t l = 0; l < nlocs; ++l) {
+            uint64_t idx;
+            if (!d.GetVarint(&idx)) return Parse::kShort;
+            if (idx >= r.dns.size()) return bad("réplica inválida");
+            if (r.names != nullptr) bm.replicas.push_back(r.dns[idx]);
+        }
+    }
+    return Parse::kOk;
+}
+
+// Recorre las 'count' entradas de una sección por ventanas. 'entry'
+// decodifica una desde el principio de la ventana; si se queda corta
+// (kShort) se amplía la ventana y se reintenta la misma entrada.
+template <typename EntryFn>
+bool DecodeEntries(SectionInput& in, uint64_t count, EntryFn&& entry, std::string* what) {
+    for (uint64_t i = 0; i < count;) {
+        coding::Decoder d(in.data(), in.size());
+        const char* bad = nullptr;
+        const Parse r = entry(d, &bad);
+        if (r == Parse::kOk) {
+            in.Consume(in.size() - d.remaining());
+            ++i;
+        } else if (r == Parse::kBad) {
+            *what = bad;
+            return false;
+        } else if (!in.More(what)) {
+            if (what->empty()) *what = "entrada truncada";
+            return false;
+        }
+    }
+    if (!in.Finished(what)) {
+        if (what->empty()) *what = "bytes sobrantes";
+        return false;
+    }
+    return true;
+}
+
+bool DecodeSection(const char* data, const SectionEntry& s, PartitionReader& r,
+                   std::vector<std::string_view>* user_ids, ImageSink& sink, std::string* err) {
+    auto in = std::make_unique<SectionInput>(data, s);
+    std::string what;
+    auto fail = [&](const std::string& w) {
+        *err = "sección " + std::to_string(s.type) + " (partición " + std::to_string(s.part) + "): " + w;
+        return false;
+    };
+    // Antes de decodificar nada: una sección dañada no entrega entradas
+    if (s.has_crc && crc32c::Value(data + s.offset, s.length) != s.crc) return fail("CRC incorrecto");
+
+    switch (s.type) {
+    case kUsers: {
+        // Tabla de cadenas: entera en memoria, las vistas deben durar
+        if (!in->ReadAll(&what)) return fail(what);
+        coding::Decoder d(in->data(), in->size());
+        user_ids->reserve(user_ids->size() + std::min<uint64_t>(s.count, in->size()));
+        for (uint64_t i = 0; i < s.count; ++i) {
+            std::string_view id, name, hash;
+            int64_t ms;
+            if (!d.GetStringView(&id) || !d.GetStringView(&name) ||
+                !d.GetStringView(&hash) || !d.GetSigned(&ms)) return fail("usuario truncado");
+            UserInfo u;
+            u.user_id.assign(id);
+            u.username.assign(name);
+            u.password_hash.assign(hash);
+            u.created_time = FromMillis(ms);
+            user_ids->push_back(id);
+            sink.OnUser(std::move(u));
+        }
+        if (!d.done()) return fail("bytes sobrantes");
+        r.tables.push_back(std::move(in));
+        return true;
+    }
+    case kDataNodes: {
+        if (!in->ReadAll(&what)) return fail(what);
+        coding::Decoder d(in->data(), in->size());
+        r.dns.reserve(r.dns.size() + std::min<uint64_t>(s.count, in->size()));
+        for (uint64_t i = 0; i < s.count; ++i) {
+            std::string_view id, addr;
+            if (!d.GetStringView(&id) || !d.GetStringView(&addr)) return fail("datanode truncado");
+            r.dns.push_back(r.names != nullptr ? r.names->IndexOf(id, addr) : 0);
+        }
+        if (!d.done()) return fail("bytes sobrantes");
+        r.tables.push_back(std::move(in));
+        return true;
+    }
+    case kDirs: {
+        std::string key;
+        const bool ok = DecodeEntries(*in, s.count, [&](coding::Decoder& d, const char** bad) {
+            const Parse p = DecodeDir(d, r, &key, bad);
+            if (p == Parse::kOk) sink.OnDirectory(r.part, std::move(key));
+            return p;
+        }, &what);
+        return ok || fail(what);
+    }
+    case kFiles: {
+        std::string key;
+        const bool ok = DecodeEntries(*in, s.count, [&](coding::Decoder& d, const char** bad) {
+            FileMetadata fm;
+            const Parse p = DecodeFile(d, r, &key, &fm, bad);
+            if (p == Parse::kOk) sink.OnFile(r.part, std::move(key), std::move(fm));
+            return p;
+        }, &what);
+        return ok || fail(what);
+    }
+    default:
+        return true;  // sección desconocida (versión posterior): se ignora
+    }
+}
+
+}  // namespace
+
+// =============================================
+// LECTOR POR PARTICIONES
+// =============================================
+
+struct ImageReader::State {
+    const char* data = nullptr;
+    size_t size = 0;
+    uint64_t txid = 0;
+    uint32_t nparts = 0;
+    // USERS primero (la usan todas), el índice de usuarios y el resto por partición
+    std::vector<SectionEntry> users;
+    std::vector<SectionEntry> user_parts;
+    std::vector<std::vector<SectionEntry>> by_part;
+
+    // Tras ReadUsers
+    std::vector<std::string_view> user_ids;
+    std::vector<uint32_t> user_partitions;
+    PartitionReader common;
+};
+
+ImageReader::ImageReader() : state_(std::make_unique<State>()) {}
+ImageReader::~ImageReader() = default;
+
+uint64_t ImageReader::txid() const { return state_->txid; }
+uint32_t ImageReader::partitions() const { return state_->nparts; }
+const std::vector<uint32_t>& ImageReader::UserPartitions() const { return state_->user_partitions; }
+
+bool ImageReader::Open(const char* data, size_t n, std::string* err) {
+    State& st = *state_;
+    if (n < kHeaderSize || !IsBinary(data, n)) {
+        *err = "cabecera inválida";
+        return false;
+    }
+    const uint32_t version = coding::GetFixed32(data + 8);
+    const uint32_t nsections = coding::GetFixed32(data + 12);
+    if (version < 1 || version > kVersion) {
+        *err = "versión no soportada: " + std::to_string(version);
+        return false;
+    }
+    const size_t entry_size = version >= 3 ? kSectionEntrySize : kSectionEntrySizeV2;
+    if (nsections > kMaxSections || kHeaderSize + entry_size * nsections > n) {
+        *err = "tabla de secciones inválida";
+        return false;
+    }
+    if (version >= 4 && TableCrc(data, kHeaderSize + entry_size * nsections) !=
+                            coding::GetFixed32(data + kTableCrcOffset)) {
+        *err = "CRC de la tabla de secciones incorrecto";
+        return false;
+    }
+    st.data = data;
+    st.size = n;
+    st.txid = coding::GetFixed64(data + 16);
+    st.nparts = version == 1 ? 1 : coding::GetFixed32(data + 24);
+    if (st.nparts == 0 || st.nparts > kMaxPartitions) {
+        *err = "número de particiones inválido: " + std::to_string(st.nparts);
+        return false;
+    }
+
+    st.by_part.resize(st.nparts);
+    for (uint32_t i = 0; i < nsections; ++i) {
+        const char* entry = data + kHeaderSize + entry_size * i;
+        SectionEntry s;
+        s.type = coding::GetFixed32(entry);
+        s.part = coding::GetFixed32(entry + 4);
+        s.offset = coding::GetFixed64(entry + 8);
+        s.length = coding::GetFixed64(entry + 16);
+        s.count = coding::GetFixed64(entry + 24);
+        s.raw_length = s.length;
+        if (version >= 3) {
+            s.raw_length = coding::GetFixed64(entry + 32);
+            s.codec = coding::GetFixed32(entry + 40);
+        }
+        if (version >= 4) {
+            s.crc = coding::GetFixed32(entry + 44);
+            s.has_crc = true;
+        }
+        if (s.offset > n || s.length > n - s.offset) {
+            *err = "sección " + std::to_string(s.type) + " fuera del archivo";
+            return false;
+        }
+        if (s.codec != kCodecNone && s.codec != kCodecZstd) {
+            *err = "sección " + std::to_string(s.type) + ": códec desconocido " + std::to_string(s.codec);
+            return false;
+        }
+        if (s.type == kUsers) {
+            st.users.push_back(s);
+        } else if (s.type == kUserParts) {
+            st.user_parts.push_back(s);
+        } else if (s.part < st.nparts) {
+            st.by_part[s.part].push_back(s);
+        } else {
+            *err = "sección " + std::to_string(s.type) + " de una partición inexistente";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageReader::Verify(unsigned threads, std::string* err) {
+    State& st = *state_;
+    std::vector<SectionEntry*> all;
+    for (auto& s : st.users) all.push_back(&s);
+    for (auto& s : st.user_parts) all.push_back(&s);
+    for (auto& part : st.by_part) {
+        for (auto& s : part) all.push_back(&s);
+    }
+    std::vector<char> bad(all.size(), 0);
+    ParallelFor(all.size(), threads, [&](size_t i) {
+        SectionEntry& s = *all[i];
+        if (s.has_crc && crc32c::Value(st.data + s.offset, s.length) != s.crc) bad[i] = 1;
+        s.has_crc = false;  // ya comprobada: Read* no la repite
+    });
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (bad[i]) {
+            *err = "sección " + std::to_string(all[i]->type) + " (partición " +
+                   std::to_string(all[i]->part) + "): CRC incorrecto";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ImageReader::ReadUsers(ImageSink& sink, std::string* err) {
+    State& st = *state_;
+    st.common.user_ids = &st.user_ids;
+    for (const SectionEntry& s : st.users) {
+        if (!DecodeSection(st.data, s, st.common, &st.user_ids, sink, err)) return false;
+    }
+    // Índice opcional; si no cuadra con USERS se ignora
+    for (const SectionEntry& s : st.user_parts) {
+        if (s.has_crc && crc32c::Value(st.data + s.offset, s.length) != s.crc) continue;
+        SectionInput in(st.data, s);
+        std::string what;
+        if (!in.ReadAll(&what)) continue;
+        coding::Decoder d(in.data(), in.size());
+        std::vector<uint32_t> parts;
+        parts.reserve(std::min<uint64_t>(s.count, in.size()));
+        uint64_t p;
+        while (parts.size() < s.count && d.GetVarint(&p) && p < st.nparts) parts.push_back(static_cast<uint32_t>(p));
+        if (parts.size() == st.user_ids.size() && d.done()) st.user_partitions = std::move(parts);
+    }
+    return true;
+}
+
+bool ImageReader::ReadPartition(uint32_t part, ImageSink& sink, std::string* err) const {
+    const State& st = *state_;
+    PartitionReader r;
+    r.part = part;
+    r.names = sink.WantLocations() ? sink.DataNodes() : nullptr;
+    r.user_ids = &st.user_ids;
+    for (const SectionEntry& s : st.by_part[part]) {
+        if (!DecodeSection(st.data, s, r, nullptr, sink, err)) return false;
+    }
+    return true;
+}
+
+bool DecodeBinary(const char* data, size_t n, ImageSink& sink, unsigned threads,
+                  uint64_t* txid, std::string* err) {
+    ImageReader reader;
+    if (!reader.Open(data, n, err) || !reader.ReadUsers(sink, err)) return false;
+    *txid = reader.txid();
+    const uint32_t nparts = reader.partitions();
+    sink.OnPartitions(nparts);
+
+    std::vector<std::string> errs(nparts);
+    ParallelFor(nparts, threads, [&](size_t p) {
+        reader.ReadPartition(static_cast<uint32_t>(p), sink, &errs[p]);
+    });
+    for (const std::string& e : errs) {
+        if (!e.empty()) {
+            *err = e;
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+// Primer '\t' o '\n' en [p, end), o end. Con SSE2 compara 16 bytes por
+// iteración; las líneas del fsimage de texto rondan los 100 bytes.
+const char* FindDelim(const char* p, const char* end) {
+#ifdef __SSE2__
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, nl)));
+        if (mask != 0) return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\t' && *p != '\n') ++p;
+    return p;
+}
+
+template <typename Int>
+bool ParseInt(std::string_view s, Int* v) {
+    const auto r = std::from_chars(s.data(), s.data() + s.size(), *v);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size();
+}
+
+}  // namespace
+
+bool DecodeText(const char* data, size_t n, ImageSink& sink, uint64_t* txid, std::string* err) {
+    // BLK y LOC se refieren a su archivo por clave/block_id: se entregan
+    // los archivos completos al final, en el orden en que aparecieron. Los
+    // índices usan vistas sobre 'data' como clave.
+    std::vector<std::pair<std::string, FileMetadata>> files;
+    std::unordered_map<std::string_view, size_t> file_index;                     // file_key -> files
+    std::unordered_map<std::string_view, std::pair<size_t, size_t>> blk_index;   // block_id -> (archivo, bloque)
+    DataNodeNames* const names = sink.WantLocations() ? sink.DataNodes() : nullptr;
+
+    constexpr size_t kMaxFields = 8;
+    std::string_view t[kMaxFields];
+    const char* p = data;
+    const char* const end = data + n;
+    size_t lineno = 0;
+    bool partitioned = false;  // OnPartitions tras los USER
+    auto fail = [&](const char* what) {
+        *err = "línea " + std::to_string(lineno) + ": " + what;
+        return false;
+    };
+
+    while (p < end) {
+        ++lineno;
+        // Campos de la línea ('nf' cuenta también los que pasan de kMaxFields)
+        size_t nf = 0;
+        for (;;) {
+            const char* q = FindDelim(p, end);
+            if (nf < kMaxFields) t[nf] = std::string_view(p, static_cast<size_t>(q - p));
+            ++nf;
+            p = q + 1;
+            if (q == end || *q == '\n') break;
+        }
+        if (nf == 1 && t[0].empty()) continue;  // línea vacía
+
+        // Cada registro tiene un número fijo de campos (etiqueta incluida)
+        size_t want = 0;
+        if (t[0] == "SEQ" || t[0] == "TXID" || t[0] == "DIR") want = 2;
+        else if (t[0] == "USER") want = 5;
+        else if (t[0] == "FILE") want = 6;
+        else if (t[0] == "BLK") want = 5;
+        else if (t[0] == "LOC") want = 4;
+        else return fail("registro desconocido");
+        if (nf != want) return fail("número de campos incorrecto");
+
+        if (t[0] == "SEQ") {
+            // Versión del formato de texto: solo existe la 1
+            if (t[1] != "1") return fail("SEQ no soportado");
+        } else if (t[0] == "TXID") {
+            if (!ParseInt(t[1], txid)) return fail("TXID inválido");
+        } else if (t[0] == "USER") {
+            int64_t ms;
+            if (!ParseInt(t[4], &ms)) return fail("fecha inválida");
+            UserInfo u;
+            u.user_id.assign(t[1]);
+            u.username.assign(t[2]);
+            u.password_hash.assign(t[3]);
+            u.created_time = FromMillis(ms);
+            sink.OnUser(std::move(u));
+        } else if (t[0] == "DIR") {
+            if (!partitioned) {
+                sink.OnPartitions(1);
+                partitioned = true;
+            }
+            sink.OnDirectory(0, std::string(t[1]));
+        } else if (t[0] == "FILE") {
+            FileMetadata fm;
+            int64_t ms;
+            if (!ParseInt(t[3], &fm.size) || !ParseInt(t[4], &ms)) return fail("FILE inválido");
+            if (!file_index.emplace(t[1], files.size()).second) return fail("FILE duplicado");
+            fm.SetOwner(t[2]);
+            fm.created_time = FromMillis(ms);
+            fm.SetFilename(t[5]);  // nombre "visible"
+            files.emplace_back(std::string(t[1]), std::move(fm));
+        } else if (t[0] == "BLK") {
+            auto it = file_index.find(t[1]);
+            if (it == file_index.end()) return fail("BLK de un archivo sin FILE previo");
+            FileMetadata& fm = files[it->second].second;
+            uint64_t idx;
+            int64_t sz;
+            if (!ParseInt(t[3], &idx) || !ParseInt(t[4], &sz)) return fail("BLK inválido");
+            if (idx != fm.blocks.size()) return fail("BLK fuera de orden");
+            if (!blk_index.emplace(t[2], std::make_pair(it->second, fm.blocks.size())).second) {
+                return fail("block_id duplicado");
+            }
+            fm.blocks.emplace_back();
+            fm.SetBlockId(fm.blocks.size() - 1, t[2]);
+            fm.blocks.back().size = sz;
+        } else {  // LOC
+            auto it = blk_index.find(t[1]);
+            if (it == blk_index.end()) return fail("LOC de un bloque sin BLK previo");
+            if (names != nullptr) {
+                auto& replicas = files[it->second.first].second.blocks[it->second.second].replicas;
+                replicas.push_back(names->IndexOf(t[2], t[3]));
+            }
+        }
+    }
+
+    if (!partitioned) sink.OnPartitions(1);
+    for (auto& f : files) sink.OnFile(0, std::move(f.first), std::move(f.second));
+    return true;
+}
+
+void ParallelFor(size_t n, unsigned threads, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < n; i = next++) fn(i);
+    };
+    const size_t nthreads = std::min<size_t>(threads == 0 ? 1 : threads, n);
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < nthreads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+
+}  // namespace fsimage
@@ -0,0 +1,177 @@
+#ifndef FSIMAGE_H
+#define FSIMAGE_H
+
+#include "metadata.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ==============================
+// Formato del fsimage
+// ==============================
+//
+// fsimage.img (binario, versión 4, little endian):
+//
+//   cabecera   "GDFSIMG\0" | u32 versión | u32 nº secciones | u64 txid
+//              | u32 nº particiones | u32 CRC32C de cabecera y tabla
+//   tabla      por sección: u32 tipo | u32 partición | u64 offset | u64 longitud
+//              | u64 nº entradas | u64 longitud sin comprimir | u32 códec | u32 CRC32C
+//   secciones  USERS, USER_PARTS (opcional) y, por partición, DATANODES, DIRS, FILES
+//
+// La tabla es el índice de offsets: cada partición (un rango de hash de
+// user_id; el NameNode escribe una por shard) se codifica y se decodifica
+// en su propio hilo sin leer las demás. USERS es común a todas;
+// USER_PARTS dice en qué partición están los datos de cada usuario, para
+// poder cargar solo la de quien los pide.
+//
+// El CRC32C de cada sección cubre sus bytes en el archivo (comprimidos si
+// lo están) y se comprueba antes de decodificarla: una imagen dañada no
+// se carga a medias.
+//
+// Códec 1: la sección es un frame zstd. Se comprime por bloques mientras
+// se codifica y se descomprime por ventanas mientras se decodifica, así
+// que ni escribir ni leer necesita la sección entera sin comprimir.
+//
+// USERS y DATANODES hacen de tablas de cadenas: DIRS y FILES guardan el
+// índice del usuario en vez de repetir user_id en cada clave, y cada
+// réplica es el índice de su par (datanode_id, address) en la tabla de su
+// partición. Los block_id con la forma que asigna CreateFile
+// (<user>_<archivo>_blk_<i>) no se guardan. Enteros como varint, cadenas
+// con prefijo de longitud. Un lector ignora los tipos de sección que no
+// conoce. Se siguen leyendo, sin CRC, la versión 3, la 2 (tabla de 32
+// bytes por sección, sin códec) y la 1 (además sin particiones: el campo
+// valía 0).
+//
+// fsimage.txt (formato anterior, líneas con '\t'); se sigue leyendo para
+// migrar y fsimage_tool convierte entre ambos:
+// SEQ 1
+// TXID  <último txid incluido>
+// USER  <user_id>\t<username>\t<password_hash>\t<created_ms>
+// DIR   <user_id>:<path>
+// FILE  <file_key>\t<owner_id>\t<size>\t<created_ms>\t<filename>
+// BLK   <file_key>\t<block_id>\t<idx>\t<size>
+// LOC   <block_id>\t<datanode_id>\t<address>
+namespace fsimage {
+
+// Qué se guarda: punteros a los datos del llamador (deben vivir durante Write*)
+struct ImageView {
+    uint64_t txid = 0;
+    std::vector<const UserInfo*> users;
+    struct File {
+        const std::string* key;                   // user_id:filename
+        const FileMetadata* meta;
+    };
+    struct Partition {
+        std::vector<const std::string*> directories;  // user_id:path
+        std::vector<File> files;
+    };
+    std::vector<Partition> partitions;            // al menos una
+    std::vector<uint32_t> user_partitions;        // opcional: partición de cada usuario (orden de 'users')
+    const DataNodeNames* datanodes = nullptr;     // id y dirección de cada réplica (si hay alguna)
+};
+
+struct WriteOptions {
+    unsigned threads = 1;     // particiones codificadas a la vez
+    int zstd_level = 3;       // <= 0: secciones sin comprimir
+    bool locations = true;    // false: los bloques sin réplicas (solo pertenencia)
+};
+
+struct WriteStats {
+    uint64_t raw_bytes = 0;   // secciones sin comprimir
+    uint64_t file_bytes = 0;  // tamaño del archivo escrito
+};
+
+// Escribe la imagen en 'fd' (desde el offset 0, con pwrite). Cada
+// partición se vuelca en cuanto termina y se libera: la memoria depende de
+// las particiones en curso, no del tamaño de la imagen. No hace fsync.
+bool WriteBinary(const ImageView& image, int fd, const WriteOptions& opts,
+                 WriteStats* stats, std::string* err);
+void WriteText(const ImageView& image, std::ostream& out);
+
+// Receptor de lo que se va leyendo (cada entrada se entrega ya completa).
+// Orden: OnUser (todos), OnPartitions y después OnDirectory/OnFile. Con
+// varios hilos, particiones distintas se entregan en paralelo; las entradas
+// de una misma partición, siempre desde un hilo y en orden.
+class ImageSink {
+public:
+    virtual ~ImageSink() = default;
+    virtual void OnUser(UserInfo&& user) = 0;
+    virtual void OnPartitions(uint32_t count) = 0;
+    virtual void OnDirectory(uint32_t part, std::string&& dir_key) = 0;
+    virtual void OnFile(uint32_t part, std::string&& file_key, FileMetadata&& meta) = 0;
+    // false: las réplicas guardadas se leen pero no se entregan
+    virtual bool WantLocations() const { return true; }
+    // Tabla que da el NodeIndex de cada réplica entregada (se llama desde
+    // los hilos de decodificación); nullptr equivale a !WantLocations()
+    virtual DataNodeNames* DataNodes() { return nullptr; }
+};
+
+// Archivo proyectado en memoria (solo lectura) para decodificar sin copiarlo
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false si no se pudo abrir: 'err' queda vacío si el archivo no existe
+    bool Open(const std::string& path, std::string* err);
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void* map_ = nullptr;
+    const char* data_ = "";
+    size_t size_ = 0;
+};
+
+bool IsBinary(const char* data, size_t n);
+
+// Lectura por partes de un fsimage binario: Open valida la cabecera y la
+// tabla, ReadUsers entrega USERS (antes que nada más) y ReadPartition una
+// partición, en cualquier orden y desde varios hilos a la vez. 'data' debe
+// vivir tanto como el lector. Las entregas no llaman a OnPartitions.
+class ImageReader {
+public:
+    ImageReader();
+    ~ImageReader();
+    ImageReader(const ImageReader&) = delete;
+    ImageReader& operator=(const ImageReader&) = delete;
+
+    bool Open(const char* data, size_t n, std::string* err);
+    // Comprueba ya el CRC de todas las secciones (las lecturas no lo repiten)
+    bool Verify(unsigned threads, std::string* err);
+    bool ReadUsers(ImageSink& sink, std::string* err);
+    bool ReadPartition(uint32_t part, ImageSink& sink, std::string* err) const;
+
+    uint64_t txid() const;
+    uint32_t partitions() const;
+    // Tras ReadUsers: partición de cada usuario en el orden de OnUser (vacío
+    // si la imagen no trae USER_PARTS)
+    const std::vector<uint32_t>& UserPartitions() const;
+
+private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+// Decodifican directamente sobre 'data' (p. ej. un MappedFile): cada cadena
+// se copia una sola vez, a la estructura que la conserva. false (con 'err')
+// si la imagen está truncada o es inconsistente. El texto es una sola
+// partición y se lee en un hilo; una etiqueta desconocida, un número de
+// campos distinto del formato o un BLK/LOC sin su FILE/BLK previo también
+// son error.
+bool DecodeBinary(const char* data, size_t n, ImageSink& sink, unsigned threads,
+                  uint64_t* txid, std::string* err);
+bool DecodeText(const char* data, size_t n, ImageSink& sink, uint64_t* txid, std::string* err);
+
+// Ejecuta fn(0..n-1) repartido en hasta 'threads' hilos (incluido el que llama)
+void ParallelFor(size_t n, unsigned threads, const std::function<void(size_t)>& fn);
+
+}  // namespace fsimage
+
+#endif // FSIMAGE_H
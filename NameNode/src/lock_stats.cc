@@ -0,0 +1,204 @@
+#include "lock_stats.h"
+#include "log.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
+#include <sstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lockstats {
+namespace {
+
+constexpr size_t kTopHolds = 10;
+
+std::atomic<Site*> g_sites{nullptr};
+
+struct Hold {
+    const Site* site;
+    uint64_t ns;
+};
+
+// Top-N de retenciones. top_floor evita tomar el mutex en el caso común
+// (retención menor que la más corta del top).
+std::mutex g_top_mu;
+std::vector<Hold> g_top;
+std::atomic<uint64_t> g_top_floor{0};
+
+void AtomicMax(std::atomic<uint64_t>& a, uint64_t v) {
+    uint64_t cur = a.load(std::memory_order_relaxed);
+    while (v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+    }
+}
+
+size_t BucketOf(uint64_t ns) {
+    if (ns == 0) return 0;
+    return 63 - static_cast<size_t>(__builtin_clzll(ns));
+}
+
+void RecordTop(const Site* site, uint64_t ns) {
+    if (ns <= g_top_floor.load(std::memory_order_relaxed)) return;
+    std::lock_guard<std::mutex> lock(g_top_mu);
+    g_top.push_back({site, ns});
+    std::sort(g_top.begin(), g_top.end(), [](const Hold& a, const Hold& b) { return a.ns > b.ns; });
+    if (g_top.size() > kTopHolds) g_top.resize(kTopHolds);
+    g_top_floor.store(g_top.size() == kTopHolds ? g_top.back().ns : 0, std::memory_order_relaxed);
+}
+
+// Hilo de volcado periódico
+std::mutex g_dump_mu;
+std::condition_variable g_dump_cv;
+bool g_dump_stop = false;
+std::thread g_dump_thread;
+
+}  // namespace
+
+// ---------- Histogram ----------
+
+void Histogram::Add(uint64_t ns) {
+    buckets_[BucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    AtomicMax(max_ns_, ns);
+}
+
+uint64_t Histogram::Count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::MaxNs() const {
+    return max_ns_.load(std::memory_order_relaxed);
+}
+
+double Histogram::MeanUs() const {
+    const uint64_t n = Count();
+    return n == 0 ? 0.0 : sum_ns_.load(std::memory_order_relaxed) / 1000.0 / n;
+}
+
+double Histogram::PercentileUs(double p) const {
+    // Copia de los contadores: pueden seguir cambiando mientras se recorren
+    std::array<uint64_t, kBuckets> snap;
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        snap[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += snap[i];
+    }
+    if (total == 0) return 0.0;
+    const uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += snap[i];
+        if (seen >= rank) {
+            const double upper_ns = (i >= 63) ? static_cast<double>(UINT64_MAX) : static_cast<double>(2ULL << i);
+            return std::min(upper_ns, static_cast<double>(MaxNs())) / 1000.0;
+        }
+    }
+    return MaxNs() / 1000.0;
+}
+
+// ---------- Site ----------
+
+Site* RegisterSite(Site* site) {
+    Site* head = g_sites.load();
+    do {
+        site->next_ = head;
+    } while (!g_sites.compare_exchange_weak(head, site));
+    return site;
+}
+
+Site::Site(const char* op, const char* lock) : op_(op), lock_(lock) {
+    RegisterSite(this);
+}
+
+void Site::RecordHold(uint64_t ns) {
+    hold_.Add(ns);
+    RecordTop(this, ns);
+}
+
+// ---------- Volcado ----------
+
+namespace {
+
+// Valores de un Site leídos una sola vez: los contadores siguen cambiando
+// mientras se ordena y se imprime
+struct SiteSnapshot {
+    const Site* site;
+    uint64_t wait_count, hold_count;
+    double wait_us[3], hold_us[3];  // p50, p99, max
+    double hold_total_us;
+};
+
+void ReadHistogram(const Histogram& h, uint64_t* count, double us[3]) {
+    *count = h.Count();
+    us[0] = h.PercentileUs(0.50);
+    us[1] = h.PercentileUs(0.99);
+    us[2] = h.MaxNs() / 1000.0;
+}
+
+}  // namespace
+
+void Dump(std::ostream& os) {
+    std::vector<SiteSnapshot> sites;
+    for (Site* s = g_sites.load(); s != nullptr; s = s->next_) {
+        SiteSnapshot snap;
+        snap.site = s;
+        ReadHistogram(s->wait(), &snap.wait_count, snap.wait_us);
+        ReadHistogram(s->hold(), &snap.hold_count, snap.hold_us);
+        snap.hold_total_us = snap.hold_count * s->hold().MeanUs();
+        if (snap.wait_count > 0 || snap.hold_count > 0) sites.push_back(snap);
+    }
+    std::sort(sites.begin(), sites.end(), [](const SiteSnapshot& a, const SiteSnapshot& b) {
+        return a.hold_total_us > b.hold_total_us;
+    });
+
+    os << std::fixed << std::setprecision(1);
+    for (const SiteSnapshot& s : sites) {
+        os << "[LockStats] op=" << s.site->op() << " lock=" << s.site->lock()
+           << " count=" << std::max(s.wait_count, s.hold_count);
+        if (s.wait_count > 0) {
+            os << " wait_us(p50/p99/max)=" << s.wait_us[0] << "/" << s.wait_us[1] << "/" << s.wait_us[2];
+        }
+        if (s.hold_count > 0) {
+            os << " hold_us(p50/p99/max)=" << s.hold_us[0] << "/" << s.hold_us[1] << "/" << s.hold_us[2];
+        }
+        os << "\n";
+    }
+
+    std::vector<Hold> top;
+    {
+        std::lock_guard<std::mutex> lock(g_top_mu);
+        top = g_top;
+    }
+    for (size_t i = 0; i < top.size(); ++i) {
+        os << "[LockStats] top" << (i + 1) << " op=" << top[i].site->op()
+           << " lock=" << top[i].site->lock()
+           << " hold_us=" << top[i].ns / 1000.0 << "\n";
+    }
+    os << std::defaultfloat << std::flush;
+}
+
+void StartPeriodicDump(std::chrono::seconds interval, std::function<void(std::ostream&)> dump) {
+    if (interval.count() <= 0 || g_dump_thread.joinable()) return;
+    g_dump_stop = false;
+    g_dump_thread = std::thread([interval, dump = std::move(dump)] {
+        std::unique_lock<std::mutex> lock(g_dump_mu);
+        while (!g_dump_cv.wait_for(lock, interval, [] { return g_dump_stop; })) {
+            std::ostringstream os;
+            dump(os);
+            LOG_INFO(os.str());
+        }
+    });
+}
+
+void StopPeriodicDump() {
+    {
+        std::lock_guard<std::mutex> lock(g_dump_mu);
+        g_dump_stop = true;
+    }
+    g_dump_cv.notify_all();
+    if (g_dump_thread.joinable()) g_dump_thread.join();
+}
+
+}  // namespace lockstats
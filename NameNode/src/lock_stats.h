@@ -0,0 +1,117 @@
+#ifndef LOCK_STATS_H
+#define LOCK_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+// ==============================
+// Instrumentación de secciones críticas
+// ==============================
+//
+// Cada sección crítica declara un Site estático (operación + lock) y toma
+// el mutex con lockstats::TimedLock en vez de std::unique_lock. Se registra:
+//   - espera: desde que se pide el lock hasta obtenerlo
+//   - retención: desde que se obtiene hasta que se suelta
+// en histogramas log2 (ns) con contadores atómicos, más un top-N global de
+// las retenciones más largas. Dump() escribe el resumen; el NameNode lo
+// vuelca cada GRIDDFS_LOCK_STATS_INTERVAL_S y al apagar.
+namespace lockstats {
+
+class Histogram {
+public:
+    static constexpr size_t kBuckets = 64;  // cubeta i: [2^i, 2^(i+1)) ns
+
+    void Add(uint64_t ns);
+    uint64_t Count() const;
+    uint64_t MaxNs() const;
+    double MeanUs() const;
+    double PercentileUs(double p) const;  // cota superior de la cubeta
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+// Punto instrumentado. Debe vivir toda la ejecución (static local).
+class Site {
+public:
+    Site(const char* op, const char* lock);
+    Site(const Site&) = delete;
+    Site& operator=(const Site&) = delete;
+
+    void RecordWait(uint64_t ns) { wait_.Add(ns); }
+    void RecordHold(uint64_t ns);
+
+    const char* op() const { return op_; }
+    const char* lock() const { return lock_; }
+    const Histogram& wait() const { return wait_; }
+    const Histogram& hold() const { return hold_; }
+
+private:
+    const char* op_;
+    const char* lock_;
+    Histogram wait_;
+    Histogram hold_;
+    Site* next_ = nullptr;  // lista global de sitios (solo se añaden)
+    friend void Dump(std::ostream& os);
+    friend Site* RegisterSite(Site* site);
+};
+
+inline uint64_t NowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Equivalente a std::unique_lock (lock/unlock/owns_lock) que mide espera y
+// retención en 'site'.
+template <typename Mutex>
+class TimedLock {
+public:
+    TimedLock(Mutex& mu, Site& site) : mu_(mu), site_(site) { lock(); }
+    ~TimedLock() { if (owns_) unlock(); }
+    TimedLock(const TimedLock&) = delete;
+    TimedLock& operator=(const TimedLock&) = delete;
+
+    void lock() {
+        const uint64_t t0 = NowNs();
+        mu_.lock();
+        acquired_ns_ = NowNs();
+        owns_ = true;
+        site_.RecordWait(acquired_ns_ - t0);
+    }
+
+    void unlock() {
+        const uint64_t held = NowNs() - acquired_ns_;
+        owns_ = false;
+        mu_.unlock();
+        site_.RecordHold(held);
+    }
+
+    bool owns_lock() const { return owns_; }
+
+private:
+    Mutex& mu_;
+    Site& site_;
+    uint64_t acquired_ns_ = 0;
+    bool owns_ = false;
+};
+
+// Resumen por sitio (p50/p99/máx de espera y retención) y top-N
+void Dump(std::ostream& os);
+
+// Volcado periódico al log (INFO) en un hilo propio (interval 0 = desactivado).
+// 'dump' escribe el informe (por defecto solo Dump; el NameNode añade sus
+// propias estadísticas)
+void StartPeriodicDump(std::chrono::seconds interval,
+                       std::function<void(std::ostream&)> dump = Dump);
+void StopPeriodicDump();
+
+}  // namespace lockstats
+
+#endif // LOCK_STATS_H
@@ -0,0 +1,176 @@
+#include "log.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace logging {
+namespace {
+
+constexpr size_t kCapacity = 16384;  // potencia de 2
+constexpr auto kIdleWait = std::chrono::milliseconds(20);
+
+Level LevelFromEnv() {
+    const char* v = std::getenv("GRIDDFS_LOG_LEVEL");
+    if (!v) return Level::kInfo;
+    const std::string s = v;
+    if (s == "debug") return Level::kDebug;
+    if (s == "warn") return Level::kWarn;
+    if (s == "error") return Level::kError;
+    return Level::kInfo;
+}
+
+// Cola acotada de varios productores y un consumidor (esquema de Vyukov):
+// cada celda lleva un número de secuencia que indica si está libre para la
+// posición 'pos' (seq == pos) o lista para leer (seq == pos + 1).
+class Logger {
+public:
+    Logger() : min_level_(LevelFromEnv()) {
+        for (size_t i = 0; i < kCapacity; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+        writer_ = std::thread(&Logger::WriterLoop, this);
+    }
+
+    ~Logger() { Stop(); }
+
+    bool Enabled(Level level) const {
+        return static_cast<uint8_t>(level) >= static_cast<uint8_t>(min_level_);
+    }
+
+    void Push(Level level, std::string msg) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells_[pos & (kCapacity - 1)];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);  // lleno
+                return;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->level = level;
+        cell->msg = std::move(msg);
+        cell->seq.store(pos + 1, std::memory_order_release);
+
+        // Los errores se escriben cuanto antes; el resto espera al siguiente ciclo
+        if (level >= Level::kWarn) cv_.notify_one();
+    }
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (stopping_) return;
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        if (writer_.joinable()) writer_.join();
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq{0};
+        Level level = Level::kInfo;
+        std::string msg;
+    };
+
+    // Vacía todo lo disponible; devuelve cuántos mensajes escribió
+    size_t Drain() {
+        out_.clear();
+        err_.clear();
+        size_t n = 0;
+        for (;;) {
+            Cell& cell = cells_[head_ & (kCapacity - 1)];
+            if (cell.seq.load(std::memory_order_acquire) != head_ + 1) break;
+            std::string& dst = (cell.level >= Level::kWarn) ? err_ : out_;
+            dst += cell.msg;
+            if (cell.msg.empty() || cell.msg.back() != '\n') dst += '\n';
+            cell.msg.clear();
+            cell.seq.store(head_ + kCapacity, std::memory_order_release);
+            ++head_;
+            ++n;
+        }
+
+        const uint64_t dropped = Dropped();
+        if (dropped != reported_dropped_) {
+            err_ += "[Log] " + std::to_string(dropped - reported_dropped_) +
+                    " mensajes descartados (buffer lleno)\n";
+            reported_dropped_ = dropped;
+        }
+
+        if (!out_.empty()) {
+            std::fwrite(out_.data(), 1, out_.size(), stdout);
+            std::fflush(stdout);
+        }
+        if (!err_.empty()) {
+            std::fwrite(err_.data(), 1, err_.size(), stderr);
+            std::fflush(stderr);
+        }
+        return n;
+    }
+
+    void WriterLoop() {
+        for (;;) {
+            if (Drain() > 0) continue;
+            std::unique_lock<std::mutex> lock(mu_);
+            if (stopping_) break;
+            cv_.wait_for(lock, kIdleWait);
+        }
+        Drain();  // lo que llegó durante la parada
+    }
+
+    const Level min_level_;
+    std::array<Cell, kCapacity> cells_;
+    alignas(64) std::atomic<size_t> tail_{0};   // productores
+    alignas(64) size_t head_ = 0;               // solo el escritor
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t reported_dropped_ = 0;
+    std::string out_, err_;                     // buffers del escritor
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+Logger& Instance() {
+    static Logger logger;
+    return logger;
+}
+
+}  // namespace
+
+bool Enabled(Level level) {
+    return Instance().Enabled(level);
+}
+
+void Write(Level level, std::string msg) {
+    Instance().Push(level, std::move(msg));
+}
+
+std::ostringstream& ThreadStream() {
+    thread_local std::ostringstream os;
+    os.str(std::string());
+    os.clear();
+    return os;
+}
+
+uint64_t DroppedCount() {
+    return Instance().Dropped();
+}
+
+void Shutdown() {
+    Instance().Stop();
+}
+
+}  // namespace logging
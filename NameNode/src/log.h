@@ -0,0 +1,57 @@
+#ifndef GRIDDFS_LOG_H
+#define GRIDDFS_LOG_H
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// ==============================
+// Logger asíncrono por niveles
+// ==============================
+//
+// Los handlers no escriben en la consola: formatean el mensaje en su hilo
+// y lo dejan en un buffer circular sin locks (varios productores, un
+// consumidor). Un hilo escritor lo vacía por lotes a stdout (DEBUG/INFO)
+// o stderr (WARN/ERROR). Si el buffer está lleno el mensaje se descarta y
+// se cuenta; un handler nunca espera por la E/S de logs.
+//
+// Nivel mínimo en tiempo de ejecución: GRIDDFS_LOG_LEVEL
+// (debug|info|warn|error, defecto info). Con GRIDDFS_NO_DEBUG_LOG definido
+// (opción CMake GRIDDFS_DEBUG_LOG=OFF) LOG_DEBUG desaparece al compilar.
+namespace logging {
+
+enum class Level : uint8_t { kDebug = 0, kInfo = 1, kWarn = 2, kError = 3 };
+
+bool Enabled(Level level);
+void Write(Level level, std::string msg);
+
+// Stream reutilizable por hilo (vacío al devolverlo)
+std::ostringstream& ThreadStream();
+
+// Mensajes descartados por buffer lleno desde el arranque
+uint64_t DroppedCount();
+
+// Vacía lo pendiente y detiene el escritor (también se hace al salir)
+void Shutdown();
+
+}  // namespace logging
+
+#define GRIDDFS_LOG(level, expr)                                   \
+    do {                                                           \
+        if (::logging::Enabled(level)) {                           \
+            std::ostringstream& griddfs_log_os_ = ::logging::ThreadStream(); \
+            griddfs_log_os_ << expr;                               \
+            ::logging::Write(level, griddfs_log_os_.str());        \
+        }                                                          \
+    } while (0)
+
+#ifdef GRIDDFS_NO_DEBUG_LOG
+#define LOG_DEBUG(expr) do {} while (0)
+#else
+#define LOG_DEBUG(expr) GRIDDFS_LOG(::logging::Level::kDebug, expr)
+#endif
+#define LOG_INFO(expr)  GRIDDFS_LOG(::logging::Level::kInfo, expr)
+#define LOG_WARN(expr)  GRIDDFS_LOG(::logging::Level::kWarn, expr)
+#define LOG_ERROR(expr) GRIDDFS_LOG(::logging::Level::kError, expr)
+
+#endif // GRIDDFS_LOG_H
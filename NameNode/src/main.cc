@@ -1,18 +1,91 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
+#include <csignal>
+#include <pthread.h>
 
 #include <grpcpp/grpcpp.h>
 
 #include "namenode_server.h"
-#include "griddfs.grpc.pb.h" 
+#include "async_server.h"
+#include "server_config.h"
+#include "control_plane.h"
+#include "griddfs.grpc.pb.h"
 
 
 int main(int argc, char** argv) {
-    std::string server_address = "0.0.0.0:50050";
+    ServerConfig config;
+    std::string err;
+    if (!config.Load(argc, argv, &err)) {
+        std::cerr << "NameNode: " << err << "\n";
+        ServerConfig::PrintUsage(std::cerr);
+        return 2;
+    }
+    if (config.help) {
+        ServerConfig::PrintUsage(std::cout);
+        return 0;
+    }
+
+    // SIGINT/SIGTERM se atienden en un hilo propio para apagar ordenadamente
+    // (el destructor del servicio escribe el último checkpoint). Se bloquean
+    // antes de crear cualquier hilo para que todos hereden la máscara.
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    const std::string& server_address = config.listen_address;
     NameNodeServiceImpl service;
+    config.Print(std::cout);
+
+    // Plano de control para DataNodes (puerto propio, hilos reservados)
+    ControlPlaneService control_service(service);
+    std::unique_ptr<grpc::Server> control;
+    if (!config.control_address.empty()) {
+        control = StartControlPlane(control_service, config.control_address, config.control_threads);
+        if (!control) {
+            std::cerr << "Fallo al iniciar el plano de control en " << config.control_address << "\n";
+            return 1;
+        }
+        std::cout << "NameNode (control) escuchando en " << config.control_address
+                  << " threads=" << config.control_threads << std::endl;
+    }
 
     grpc::ServerBuilder builder;
+    config.Apply(builder);
+
+    if (config.server_mode == "async") {
+        AsyncServerOptions opts;
+        opts.address = server_address;
+        opts.num_cqs = config.cqs;
+        opts.threads_per_cq = config.cq_threads;
+        opts.pin_cpus = config.cpu_pin;
+
+        AsyncNameNodeServer server(service, opts);
+        if (!server.Start(builder)) {
+            std::cerr << "Fallo al iniciar el servidor gRPC\n";
+            return 1;
+        }
+
+        std::thread([&server, &control, stop_signals] {
+            int sig = 0;
+            sigwait(&stop_signals, &sig);
+            std::cout << "NameNode: señal " << sig << ", apagando..." << std::endl;
+            server.Shutdown();
+            if (control) control->Shutdown();
+        }).detach();
+
+        std::cout << "NameNode (async) escuchando en " << server_address
+                  << " cqs=" << server.options().num_cqs
+                  << " threads_per_cq=" << server.options().threads_per_cq
+                  << " cpu_pin=" << (server.options().pin_cpus ? 1 : 0) << std::endl;
+        server.Wait();
+        if (control) control->Wait();
+        return 0;
+    }
+
     // Escuchar en la dirección
     builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
     // Registrar servicio
@@ -24,7 +97,16 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    std::thread([&server, &control, stop_signals] {
+        int sig = 0;
+        sigwait(&stop_signals, &sig);
+        std::cout << "NameNode: señal " << sig << ", apagando..." << std::endl;
+        server->Shutdown();
+        if (control) control->Shutdown();
+    }).detach();
+
     std::cout << "NameNode escuchando en " << server_address << std::endl;
     server->Wait();
+    if (control) control->Wait();
     return 0;
 }
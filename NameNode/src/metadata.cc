@@ -0,0 +1,56 @@
+#include "metadata.h"
+
+namespace {
+
+constexpr std::string_view kBlockSep = "_blk_";
+
+// 'v' empieza por 'prefix': lo consume
+bool Consume(std::string_view* v, std::string_view prefix) {
+    if (v->substr(0, prefix.size()) != prefix) return false;
+    v->remove_prefix(prefix.size());
+    return true;
+}
+
+}  // namespace
+
+bool FileMetadata::FilenameIs(std::string_view filename) const {
+    return Consume(&filename, dir.str()) && filename == name;
+}
+
+void FileMetadata::SetFilename(std::string_view filename) {
+    const size_t slash = filename.rfind('/');
+    const size_t cut = slash == std::string_view::npos ? 0 : slash + 1;
+    dir = symbols::Intern(filename.substr(0, cut));
+    name.assign(filename.data() + cut, filename.size() - cut);
+}
+
+void FileMetadata::BlockId(size_t i, std::string* out) const {
+    if (!blocks[i].id.empty()) {
+        *out = blocks[i].id.str();
+        return;
+    }
+    const std::string& user = owner_id();
+    const std::string& d = dir.str();
+    const std::string idx = std::to_string(i);
+    out->clear();
+    out->reserve(user.size() + 1 + d.size() + name.size() + kBlockSep.size() + idx.size());
+    out->append(user).append(1, '_').append(d).append(name).append(kBlockSep).append(idx);
+}
+
+std::string FileMetadata::BlockId(size_t i) const {
+    std::string id;
+    BlockId(i, &id);
+    return id;
+}
+
+bool FileMetadata::HasBlockId(size_t i, std::string_view block_id) const {
+    if (!blocks[i].id.empty()) return blocks[i].id.str() == block_id;
+    return Consume(&block_id, owner_id()) && Consume(&block_id, "_") &&
+           Consume(&block_id, dir.str()) && Consume(&block_id, name) &&
+           Consume(&block_id, kBlockSep) && block_id == std::to_string(i);
+}
+
+void FileMetadata::SetBlockId(size_t i, std::string_view block_id) {
+    blocks[i].id = symbols::Ref();
+    if (!HasBlockId(i, block_id)) blocks[i].id = symbols::Intern(block_id);
+}
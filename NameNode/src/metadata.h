@@ -0,0 +1,74 @@
+#ifndef METADATA_H
+#define METADATA_H
+
+#include "symbols.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ==============================
+// Estructuras de metadatos
+// ==============================
+
+// Información de usuario
+struct UserInfo {
+    std::string user_id;
+    std::string username;
+    std::string password_hash;
+    std::chrono::system_clock::time_point created_time;
+};
+
+// DataNode de una réplica: índice estable en la tabla de DataNodes
+// (DataNodeNames), que guarda id, dirección y estadísticas una sola vez
+using NodeIndex = uint32_t;
+
+// Bloque de un archivo
+struct BlockMeta {
+    symbols::Ref id;                 // vacío: el block_id que asigna CreateFile (ver FileMetadata::BlockId)
+    int64_t size = 0;
+    std::vector<NodeIndex> replicas;
+};
+
+// Correspondencia entre NodeIndex y DataNode. En el NameNode es
+// DataNodeRegistry; fsimage_tool, que solo convierte imágenes, usa una
+// tabla propia. Ambos métodos pueden llamarse desde varios hilos.
+class DataNodeNames {
+public:
+    virtual ~DataNodeNames() = default;
+    // Índice de 'id', que se crea si es nuevo. 'address' es la guardada con
+    // la réplica: vale hasta que el nodo se registre con la suya
+    virtual NodeIndex IndexOf(std::string_view id, std::string_view address) = 0;
+    // id y dirección actuales de un índice devuelto por IndexOf
+    virtual void Lookup(NodeIndex node, std::string* id, std::string* address) const = 0;
+};
+
+// Metadata de archivo con propietario y bloques. Las cadenas que comparten
+// muchos archivos (propietario, directorio) están internadas (symbols.h);
+// el nombre propio y el block_id por defecto no se repiten.
+struct FileMetadata {
+    symbols::Ref owner;  // user_id
+    symbols::Ref dir;    // filename hasta la última '/' (incluida)
+    std::string name;    // filename tras la última '/'
+    int64_t size = 0;
+    std::chrono::system_clock::time_point created_time;
+    std::vector<BlockMeta> blocks;
+
+    const std::string& owner_id() const { return owner.str(); }
+    void SetOwner(std::string_view user_id) { owner = symbols::Intern(user_id); }
+
+    std::string filename() const { return dir.str() + name; }
+    bool FilenameIs(std::string_view filename) const;
+    void SetFilename(std::string_view filename);
+
+    // block_id del bloque i: el guardado o <owner_id>_<filename>_blk_<i>
+    std::string BlockId(size_t i) const;
+    void BlockId(size_t i, std::string* out) const;
+    bool HasBlockId(size_t i, std::string_view block_id) const;
+    // Con owner y filename ya asignados; solo se interna si no es el de defecto
+    void SetBlockId(size_t i, std::string_view block_id);
+};
+
+#endif // METADATA_H
@@ -0,0 +1,767 @@
+// Benchmarks contra un NameNode en marcha (cliente gRPC):
+//   namenode_bench read [opciones]   lecturas/s y latencia de GetFileInfo y
+//                                    ListFiles según el nº de hilos lectores
+//   namenode_bench tail [opciones]   latencia (p50/p99/p99.9) de las mismas
+//                                    lecturas con y sin escritores a la vez
+//   namenode_bench heartbeat [opc.]  latencia de Heartbeat, RegisterDataNode y
+//                                    BlockReport durante una tormenta de
+//                                    clientes, por el puerto principal y por el
+//                                    plano de control
+//   namenode_bench blockreport [o.]  duración de BlockReport según el nº de
+//                                    bloques reportados, con espacios de
+//                                    nombres de distintos tamaños: el primer
+//                                    reporte de un DataNode (añade réplicas)
+//                                    y el mismo reporte repetido
+//   namenode_bench listcheck [o.]    comprobación, no medida: crea y borra
+//                                    archivos y directorios al azar y compara
+//                                    cada ListFiles con el listado que daba el
+//                                    recorrido de todas las claves del usuario
+//                                    (anterior al árbol de directorios). Con
+//                                    --phase=ops, reiniciar el NameNode (también
+//                                    con GRIDDFS_LAZY_LOAD=1) y --phase=list con
+//                                    la misma --seed se comprueba lo recuperado
+// Opciones (--clave=valor):
+//   --target=localhost:50050   servidor de clientes
+//   --control=localhost:50060  (heartbeat) plano de control
+//   --threads=1,2,4,8,16       (read) hilos lectores de cada medida
+//   --readers=4                (tail) hilos lectores
+//   --writers=0,4,16           (tail) hilos que crean y borran archivos del
+//                              mismo usuario (misma partición) mientras se mide
+//   --storm=0,64               (heartbeat) hilos de la tormenta de clientes
+//   --report=100               (heartbeat) bloques de cada BlockReport
+//   --reports=100,1000,10000   (blockreport) bloques de cada reporte
+//   --namespace=10000,100000   (blockreport) archivos totales de cada medida
+//   --reps=5                   (blockreport) reportes medidos de cada tipo
+//   --seed=1 --ops=3000        (listcheck) operaciones aleatorias que se aplican
+//   --phase=all                (listcheck) all: aplica y comprueba; ops: igual
+//                              (para reiniciar después); list: solo comprueba
+//   --files=2000 --dirs=20     archivos que se crean antes de medir (y en
+//                              cuántos directorios se reparten)
+//   --seconds=5                duración de cada medida
+// Para medir también los checkpoints bajo carga, arrancar el NameNode con
+// un GRIDDFS_CHECKPOINT_TXNS bajo.
+// Crea su propio usuario y registra DataNodes ficticios, así que no
+// necesita DataNodes reales; usar un GRIDDFS_META_DIR desechable. Cada
+// hilo abre su propia conexión.
+#include <grpcpp/grpcpp.h>
+#include "griddfs.grpc.pb.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using griddfs::NameNodeService;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// ==============================
+// Opciones
+// ==============================
+
+class Options {
+public:
+    bool Parse(int argc, char** argv, int first) {
+        for (int i = first; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const size_t eq = arg.find('=');
+            if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) return false;
+            values_[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+        }
+        return true;
+    }
+    std::string Str(const std::string& key, const std::string& def) const {
+        auto it = values_.find(key);
+        return it == values_.end() ? def : it->second;
+    }
+    long Int(const std::string& key, long def) const {
+        auto it = values_.find(key);
+        return it == values_.end() ? def : std::strtol(it->second.c_str(), nullptr, 10);
+    }
+    // "0,2,4" -> {0, 2, 4}
+    std::vector<long> List(const std::string& key, const std::string& def) const {
+        std::vector<long> out;
+        const std::string s = Str(key, def);
+        for (size_t p = 0; p < s.size();) {
+            size_t c = s.find(',', p);
+            if (c == std::string::npos) c = s.size();
+            const long v = std::strtol(s.substr(p, c - p).c_str(), nullptr, 10);
+            if (v >= 0) out.push_back(v);
+            p = c + 1;
+        }
+        return out;
+    }
+
+private:
+    std::map<std::string, std::string> values_;
+};
+
+// ==============================
+// Cliente
+// ==============================
+
+// Canal propio (sin compartir la conexión con otros hilos)
+std::unique_ptr<NameNodeService::Stub> Connect(const std::string& target) {
+    grpc::ChannelArguments args;
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    return NameNodeService::NewStub(
+        grpc::CreateCustomChannel(target, grpc::InsecureChannelCredentials(), args));
+}
+
+// Latencias de una medida (µs)
+class Latencies {
+public:
+    void Add(Clock::duration d) {
+        us_.push_back(std::chrono::duration<double, std::micro>(d).count());
+    }
+    void Merge(const Latencies& other) {
+        us_.insert(us_.end(), other.us_.begin(), other.us_.end());
+    }
+    size_t Count() const { return us_.size(); }
+    double Percentile(double p) {
+        if (us_.empty()) return 0;
+        std::sort(us_.begin(), us_.end());
+        return us_[std::min(us_.size() - 1, static_cast<size_t>(p * us_.size()))];
+    }
+
+private:
+    std::vector<double> us_;
+};
+
+void Report(const std::string& what, size_t threads, double seconds, size_t errors, Latencies& lat) {
+    std::cout << std::fixed << std::setprecision(1)
+              << "[Bench] " << what << " threads=" << threads << " ops=" << lat.Count()
+              << " ops_s=" << lat.Count() / seconds << " errors=" << errors
+              << " p50_us=" << lat.Percentile(0.50) << " p99_us=" << lat.Percentile(0.99)
+              << " p999_us=" << lat.Percentile(0.999) << " max_us=" << lat.Percentile(1.0)
+              << std::defaultfloat << std::endl;
+}
+
+// Usuario propio de esta ejecución; "" si falla
+std::string RegisterBenchUser(NameNodeService::Stub& stub) {
+    griddfs::RegisterUserRequest req;
+    req.set_username("bench_" + std::to_string(::getpid()) + "_" +
+                     std::to_string(std::chrono::system_clock::now().time_since_epoch().count()));
+    req.set_password("bench");
+    griddfs::RegisterUserResponse resp;
+    grpc::ClientContext ctx;
+    if (!stub.RegisterUser(&ctx, req, &resp).ok() || !resp.success()) return "";
+    return resp.user_id();
+}
+
+// DataNode ficticio (sin servidor detrás)
+bool RegisterDataNode(NameNodeService::Stub& stub, const std::string& id, int port) {
+    griddfs::RegisterDataNodeRequest req;
+    req.mutable_datanode()->set_id(id);
+    req.mutable_datanode()->set_address("127.0.0.1:" + std::to_string(port));
+    req.mutable_datanode()->set_capacity(1LL << 40);
+    req.mutable_datanode()->set_free_space(1LL << 40);
+    griddfs::RegisterDataNodeResponse resp;
+    grpc::ClientContext ctx;
+    return stub.RegisterDataNode(&ctx, req, &resp).ok() && resp.success();
+}
+
+// DataNodes ficticios para que CreateFile pueda colocar réplicas
+bool RegisterDataNodes(NameNodeService::Stub& stub, int count) {
+    for (int i = 1; i <= count; ++i) {
+        if (!RegisterDataNode(stub, "bench-dn-" + std::to_string(i), 59000 + i)) return false;
+    }
+    return true;
+}
+
+std::string BenchFile(long i, long dirs) {
+    return "/bench/d" + std::to_string(i % dirs) + "/f" + std::to_string(i);
+}
+
+// Crea los archivos [first, last) repartidos entre 'threads' conexiones
+bool CreateFiles(const std::string& target, const std::string& user_id, long first, long last,
+                 long dirs, int64_t size, unsigned threads) {
+    std::atomic<long> next{first};
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&] {
+            auto stub = Connect(target);
+            for (long i = next++; i < last && ok; i = next++) {
+                griddfs::CreateFileRequest req;
+                req.set_filename(BenchFile(i, dirs));
+                req.set_filesize(size);
+                req.set_user_id(user_id);
+                griddfs::CreateFileResponse resp;
+                grpc::ClientContext ctx;
+                const grpc::Status s = stub->CreateFile(&ctx, req, &resp);
+                if (!s.ok() && s.error_code() != grpc::StatusCode::ALREADY_EXISTS) {
+                    std::cerr << "CreateFile: " << s.error_message() << "\n";
+                    ok = false;
+                }
+            }
+        });
+    }
+    for (auto& t : pool) t.join();
+    return ok;
+}
+
+// Ejecuta 'op' en 'threads' hilos durante 'seconds' y devuelve sus latencias
+template <typename Op>
+Latencies RunFor(const std::string& target, size_t threads, double seconds, size_t* errors, Op op) {
+    std::vector<Latencies> per_thread(threads);
+    std::atomic<size_t> failed{0};
+    const Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                     std::chrono::duration<double>(seconds));
+    std::vector<std::thread> pool;
+    for (size_t t = 0; t < threads; ++t) {
+        pool.emplace_back([&, t] {
+            auto stub = Connect(target);
+            for (uint64_t n = 0; Clock::now() < end; ++n) {
+                const Clock::time_point t0 = Clock::now();
+                if (!op(*stub, t, n)) ++failed;
+                per_thread[t].Add(Clock::now() - t0);
+            }
+        });
+    }
+    for (auto& t : pool) t.join();
+    Latencies all;
+    for (const auto& l : per_thread) all.Merge(l);
+    *errors = failed;
+    return all;
+}
+
+// Carga de fondo: 'threads' hilos repitiendo op(stub, t, n) hasta Stop()
+class Load {
+public:
+    template <typename Op>
+    void Start(const std::string& target, long threads, Op op) {
+        for (long t = 0; t < threads; ++t) {
+            pool_.emplace_back([this, target, t, op] {
+                auto stub = Connect(target);
+                for (uint64_t n = 0; !stop_; ++n) ops_ += op(*stub, static_cast<size_t>(t), n);
+            });
+        }
+    }
+    // Detiene los hilos y devuelve cuántas operaciones completaron
+    uint64_t Stop() {
+        stop_ = true;
+        for (auto& t : pool_) t.join();
+        pool_.clear();
+        return ops_;
+    }
+    ~Load() { Stop(); }
+
+private:
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> ops_{0};
+    std::vector<std::thread> pool_;
+};
+
+// ==============================
+// Modos
+// ==============================
+
+// Usuario, DataNodes y archivos de partida; "" si falla
+std::string Prepare(const Options& opts, const char* mode, long files, long dirs) {
+    const std::string target = opts.Str("target", "localhost:50050");
+    auto stub = Connect(target);
+    const std::string user_id = RegisterBenchUser(*stub);
+    if (user_id.empty() || !RegisterDataNodes(*stub, 3)) {
+        std::cerr << "no se pudo preparar el usuario o los DataNodes en " << target << "\n";
+        return "";
+    }
+    const Clock::time_point t0 = Clock::now();
+    if (!CreateFiles(target, user_id, 0, files, dirs, 1, 16)) return "";
+    std::cout << "[Bench] " << mode << " files=" << files << " dirs=" << dirs << " setup_ms="
+              << std::chrono::duration<double, std::milli>(Clock::now() - t0).count() << std::endl;
+    return user_id;
+}
+
+bool GetFileInfo(NameNodeService::Stub& stub, const std::string& user_id, const std::string& filename) {
+    griddfs::GetFileInfoRequest req;
+    req.set_filename(filename);
+    req.set_user_id(user_id);
+    griddfs::GetFileInfoResponse resp;
+    grpc::ClientContext ctx;
+    return stub.GetFileInfo(&ctx, req, &resp).ok();
+}
+
+bool ListFiles(NameNodeService::Stub& stub, const std::string& user_id, const std::string& dir) {
+    griddfs::ListFilesRequest req;
+    req.set_directory(dir);
+    req.set_user_id(user_id);
+    griddfs::ListFilesResponse resp;
+    grpc::ClientContext ctx;
+    return stub.ListFiles(&ctx, req, &resp).ok();
+}
+
+// Crea y borra 'filename'; devuelve cuántas de las dos operaciones fueron bien
+int Churn(NameNodeService::Stub& stub, const std::string& user_id, const std::string& filename) {
+    griddfs::CreateFileRequest creq;
+    creq.set_filename(filename);
+    creq.set_filesize(1);
+    creq.set_user_id(user_id);
+    griddfs::CreateFileResponse cresp;
+    grpc::ClientContext cctx;
+    const int created = stub.CreateFile(&cctx, creq, &cresp).ok() ? 1 : 0;
+    griddfs::DeleteFileRequest dreq;
+    dreq.set_filename(filename);
+    dreq.set_user_id(user_id);
+    griddfs::DeleteFileResponse dresp;
+    grpc::ClientContext dctx;
+    return created + (stub.DeleteFile(&dctx, dreq, &dresp).ok() ? 1 : 0);
+}
+
+int RunRead(const Options& opts) {
+    const std::string target = opts.Str("target", "localhost:50050");
+    const long files = std::max(1L, opts.Int("files", 2000));
+    const long dirs = std::max(1L, opts.Int("dirs", 20));
+    const double seconds = std::max(1L, opts.Int("seconds", 5));
+    const std::string user_id = Prepare(opts, "read", files, dirs);
+    if (user_id.empty()) return 1;
+
+    for (long threads : opts.List("threads", "1,2,4,8,16")) {
+        if (threads == 0) continue;
+        size_t errors = 0;
+        Latencies info = RunFor(target, threads, seconds, &errors,
+                                [&](NameNodeService::Stub& s, size_t t, uint64_t n) {
+            return GetFileInfo(s, user_id, BenchFile(static_cast<long>((n * 7919 + t * 104729) % files), dirs));
+        });
+        Report("read op=GetFileInfo", threads, seconds, errors, info);
+
+        Latencies list = RunFor(target, threads, seconds, &errors,
+                                [&](NameNodeService::Stub& s, size_t t, uint64_t n) {
+            return ListFiles(s, user_id, "/bench/d" + std::to_string((n + t) % dirs));
+        });
+        Report("read op=ListFiles", threads, seconds, errors, list);
+    }
+    return 0;
+}
+
+int RunTail(const Options& opts) {
+    const std::string target = opts.Str("target", "localhost:50050");
+    const long files = std::max(1L, opts.Int("files", 2000));
+    const long dirs = std::max(1L, opts.Int("dirs", 20));
+    const double seconds = std::max(1L, opts.Int("seconds", 5));
+    const long readers = std::max(1L, opts.Int("readers", 4));
+    const std::string user_id = Prepare(opts, "tail", files, dirs);
+    if (user_id.empty()) return 1;
+
+    for (long writers : opts.List("writers", "0,4,16")) {
+        // Escritores: crean y borran archivos en /churn hasta que se pare la medida
+        Load churn;
+        churn.Start(target, writers, [&](NameNodeService::Stub& s, size_t t, uint64_t n) {
+            return Churn(s, user_id, "/churn/w" + std::to_string(t) + "_" + std::to_string(n));
+        });
+        const Clock::time_point t0 = Clock::now();
+        const std::string what = " writers=" + std::to_string(writers);
+
+        size_t errors = 0;
+        Latencies info = RunFor(target, readers, seconds, &errors,
+                                [&](NameNodeService::Stub& s, size_t t, uint64_t n) {
+            return GetFileInfo(s, user_id, BenchFile(static_cast<long>((n * 7919 + t * 104729) % files), dirs));
+        });
+        Report("tail op=GetFileInfo" + what, readers, seconds, errors, info);
+
+        Latencies list = RunFor(target, readers, seconds, &errors,
+                                [&](NameNodeService::Stub& s, size_t t, uint64_t n) {
+            return ListFiles(s, user_id, "/bench/d" + std::to_string((n + t) % dirs));
+        });
+        Report("tail op=ListFiles" + what, readers, seconds, errors, list);
+
+        const uint64_t writes = churn.Stop();
+        const double elapsed = std::chrono::duration<double>(Clock::now() - t0).count();
+        std::cout << std::fixed << std::setprecision(1) << "[Bench] tail" << what
+                  << " writes=" << writes << " writes_s=" << writes / elapsed
+                  << std::defaultfloat << std::endl;
+    }
+    return 0;
+}
+
+int Usage();
+
+// Hasta 'limit' bloques de los primeros archivos con réplica en 'datanode_id'
+// ("" = cualquiera)
+std::vector<std::string> BlocksOn(NameNodeService::Stub& stub, const std::string& user_id,
+                                  long files, long dirs, const std::string& datanode_id, size_t limit) {
+    std::vector<std::string> out;
+    for (long i = 0; i < files && out.size() < limit; ++i) {
+        griddfs::GetFileInfoRequest req;
+        req.set_filename(BenchFile(i, dirs));
+        req.set_user_id(user_id);
+        griddfs::GetFileInfoResponse resp;
+        grpc::ClientContext ctx;
+        if (!stub.GetFileInfo(&ctx, req, &resp).ok()) continue;
+        for (const auto& b : resp.blocks()) {
+            for (const auto& dn : b.datanodes()) {
+                if ((datanode_id.empty() || dn.id() == datanode_id) && out.size() < limit) {
+                    out.push_back(b.block_id());
+                    break;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+int RunHeartbeat(const Options& opts) {
+    const std::string target = opts.Str("target", "localhost:50050");
+    const std::string control = opts.Str("control", "localhost:50060");
+    const long files = std::max(1L, opts.Int("files", 2000));
+    const long dirs = std::max(1L, opts.Int("dirs", 20));
+    const double seconds = std::max(1L, opts.Int("seconds", 5));
+    const std::string user_id = Prepare(opts, "heartbeat", files, dirs);
+    if (user_id.empty()) return 1;
+    auto stub = Connect(target);
+    const std::vector<std::string> report =
+        BlocksOn(*stub, user_id, files, dirs, "bench-dn-1", static_cast<size_t>(opts.Int("report", 100)));
+
+    for (long storm : opts.List("storm", "0,64")) {
+        // Tormenta de clientes en el puerto principal: lecturas y, una de cada
+        // cinco, un CreateFile + DeleteFile (compite por shard.mu con BlockReport)
+        Load load;
+        load.Start(target, storm, [&](NameNodeService::Stub& s, size_t t, uint64_t n) {
+            if (n % 5 == 4) {
+                return Churn(s, user_id, "/churn/s" + std::to_string(t) + "_" + std::to_string(n));
+            }
+            if (n % 2) return ListFiles(s, user_id, "/bench/d" + std::to_string((n + t) % dirs)) ? 1 : 0;
+            return GetFileInfo(s, user_id, BenchFile(static_cast<long>((n * 7919 + t) % files), dirs)) ? 1 : 0;
+        });
+        const Clock::time_point t0 = Clock::now();
+
+        // RPCs de DataNode, por el puerto principal y por el plano de control
+        for (const std::string& port : {target, control}) {
+            const std::string what = " storm=" + std::to_string(storm) + " via=" + port;
+            size_t errors = 0;
+            Latencies hb = RunFor(port, 1, seconds, &errors,
+                                  [&](NameNodeService::Stub& s, size_t, uint64_t) {
+                griddfs::HeartbeatRequest req;
+                req.set_datanode_id("bench-dn-1");
+                req.set_free_space(1LL << 40);
+                griddfs::HeartbeatResponse resp;
+                grpc::ClientContext ctx;
+                return s.Heartbeat(&ctx, req, &resp).ok() && resp.success();
+            });
+            Report("heartbeat op=Heartbeat" + what, 1, seconds, errors, hb);
+
+            Latencies reg = RunFor(port, 1, seconds, &errors,
+                                   [&](NameNodeService::Stub& s, size_t, uint64_t) {
+                griddfs::RegisterDataNodeRequest req;
+                req.mutable_datanode()->set_id("bench-dn-1");
+                req.mutable_datanode()->set_address("127.0.0.1:59001");
+                req.mutable_datanode()->set_capacity(1LL << 40);
+                req.mutable_datanode()->set_free_space(1LL << 40);
+                griddfs::RegisterDataNodeResponse resp;
+                grpc::ClientContext ctx;
+                return s.RegisterDataNode(&ctx, req, &resp).ok() && resp.success();
+            });
+            Report("heartbeat op=RegisterDataNode" + what, 1, seconds, errors, reg);
+
+            Latencies br = RunFor(port, 1, seconds, &errors,
+                                  [&](NameNodeService::Stub& s, size_t, uint64_t) {
+                griddfs::BlockReportRequest req;
+                req.set_datanode_id("bench-dn-1");
+                for (const auto& id : report) req.add_block_ids(id);
+                griddfs::BlockReportResponse resp;
+                grpc::ClientContext ctx;
+                return s.BlockReport(&ctx, req, &resp).ok() && resp.success();
+            });
+            Report("heartbeat op=BlockReport blocks=" + std::to_string(report.size()) + what, 1,
+                   seconds, errors, br);
+        }
+
+        const uint64_t ops = load.Stop();
+        std::cout << std::fixed << std::setprecision(1) << "[Bench] heartbeat storm=" << storm
+                  << " client_ops_s=" << ops / std::chrono::duration<double>(Clock::now() - t0).count()
+                  << std::defaultfloat << std::endl;
+    }
+    return 0;
+}
+
+int RunBlockReport(const Options& opts) {
+    const std::string target = opts.Str("target", "localhost:50050");
+    const long dirs = std::max(1L, opts.Int("dirs", 20));
+    const long reps = std::max(1L, opts.Int("reps", 5));
+    std::vector<long> sizes = opts.List("reports", "100,1000,10000");
+    std::vector<long> namespaces = opts.List("namespace", "10000,100000");
+    std::sort(namespaces.begin(), namespaces.end());
+    if (sizes.empty() || namespaces.empty()) return Usage();
+    const long max_report = *std::max_element(sizes.begin(), sizes.end());
+
+    auto stub = Connect(target);
+    const std::string user_id = RegisterBenchUser(*stub);
+    if (user_id.empty() || !RegisterDataNodes(*stub, 3)) {
+        std::cerr << "no se pudo preparar el usuario o los DataNodes en " << target << "\n";
+        return 1;
+    }
+
+    // Los mismos bloques (los de los primeros archivos) en todas las medidas:
+    // solo crece el espacio de nombres alrededor
+    long created = 0;
+    std::vector<std::string> blocks;
+    for (long ns : namespaces) {
+        const Clock::time_point t0 = Clock::now();
+        if (!CreateFiles(target, user_id, created, ns, dirs, 1, 16)) return 1;
+        created = std::max(created, ns);
+        std::cout << std::fixed << std::setprecision(1) << "[Bench] blockreport namespace=" << created
+                  << " setup_ms=" << std::chrono::duration<double, std::milli>(Clock::now() - t0).count()
+                  << std::defaultfloat << std::endl;
+        if (blocks.empty()) blocks = BlocksOn(*stub, user_id, created, dirs, "", static_cast<size_t>(max_report));
+
+        for (long size : sizes) {
+            griddfs::BlockReportRequest req;
+            for (long k = 0; k < size && k < static_cast<long>(blocks.size()); ++k) req.add_block_ids(blocks[k]);
+            // Primer reporte de un DataNode nuevo (cada repetición con otro id):
+            // añade una réplica por bloque, publica versiones y escribe en el
+            // edit log. Después, el mismo reporte repetido (el periódico de un
+            // DataNode que ya estaba), que no cambia nada
+            Latencies fresh, repeat;
+            size_t errors = 0;
+            auto timed = [&](Latencies& lat) {
+                griddfs::BlockReportResponse resp;
+                grpc::ClientContext ctx;
+                const Clock::time_point t1 = Clock::now();
+                if (!stub->BlockReport(&ctx, req, &resp).ok() || !resp.success()) ++errors;
+                lat.Add(Clock::now() - t1);
+            };
+            for (long r = 0; r < reps; ++r) {
+                const std::string dn = "bench-br-" + std::to_string(created) + "-" + std::to_string(size) + "-" +
+                                       std::to_string(r);
+                if (!RegisterDataNode(*stub, dn, 59100)) {
+                    std::cerr << "no se pudo registrar el DataNode " << dn << "\n";
+                    return 1;
+                }
+                req.set_datanode_id(dn);
+                timed(fresh);
+            }
+            for (long r = 0; r < reps; ++r) timed(repeat);
+            const int n = std::max(1, req.block_ids_size());
+            std::cout << std::fixed << std::setprecision(1) << "[Bench] blockreport namespace=" << created
+                      << " blocks=" << req.block_ids_size() << " reps=" << reps << " errors=" << errors
+                      << " new_p50_us=" << fresh.Percentile(0.50) << " new_max_us=" << fresh.Percentile(1.0)
+                      << " new_us_per_block=" << fresh.Percentile(0.50) / n
+                      << " repeat_p50_us=" << repeat.Percentile(0.50) << " repeat_max_us=" << repeat.Percentile(1.0)
+                      << " repeat_us_per_block=" << repeat.Percentile(0.50) / n
+                      << std::defaultfloat << std::endl;
+        }
+    }
+    return 0;
+}
+
+// ==============================
+// Comprobación de ListFiles
+// ==============================
+
+// Archivos y directorios de un usuario según las operaciones aplicadas
+struct UserModel {
+    std::map<std::string, int64_t> files;  // filename -> size
+    std::set<std::string> dirs;            // creados con CreateDirectory
+};
+
+bool StartsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Listado de 'dir' calculado como lo hacía ListFiles antes del árbol de
+// directorios (recorriendo todas las claves del usuario): "nombre|size",
+// con los subdirectorios como "📁 nombre|0"
+std::vector<std::string> ModelList(const UserModel& m, const std::string& dir) {
+    // Nombre del hijo directo de 'dir' en 'path' ("" si no lo es)
+    auto child = [&](const std::string& path, std::string* name) {
+        if (dir == "/") {
+            if (path.size() <= 1 || path[0] != '/') return false;
+            *name = path.substr(1);
+        } else {
+            if (!StartsWith(path, dir + "/")) return false;
+            *name = path.substr(dir.size() + 1);
+        }
+        return name->find('/') == std::string::npos;
+    };
+    std::set<std::string> dirs = m.dirs;
+    for (const auto& f : m.files) {
+        std::string path = f.first;
+        for (size_t slash = path.rfind('/'); slash != std::string::npos; slash = path.rfind('/')) {
+            path.resize(slash);
+            if (!path.empty()) dirs.insert(path);
+        }
+    }
+    std::vector<std::string> out;
+    std::string name;
+    for (const auto& d : dirs) {
+        if (child(d, &name) && !name.empty()) out.push_back("\xF0\x9F\x93\x81 " + name + "|0");
+    }
+    for (const auto& f : m.files) {
+        if (child(f.first, &name)) out.push_back(name + "|" + std::to_string(f.second));
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// Aplica 'ops' operaciones aleatorias (semilla 'seed') al modelo y, si hay
+// stub, también al NameNode; cuenta las respuestas que no coinciden
+size_t ApplyListOps(NameNodeService::Stub* stub, const std::vector<std::string>& users, unsigned seed,
+                    long ops, std::vector<UserModel>* models) {
+    static const char* const kNames[] = {"a", "b", "c", "", "docs", "x y"};
+    std::mt19937 rng(seed);
+    size_t mismatches = 0;
+    for (long i = 0; i < ops; ++i) {
+        const size_t u = rng() % users.size();
+        std::string path = rng() % 8 != 0 ? "/" : "";  // también rutas relativas
+        const unsigned depth = rng() % 4;
+        for (unsigned d = 0; d <= depth; ++d) path.append(d ? "/" : "").append(kNames[rng() % 6]);
+        const unsigned op = rng() % 10;
+        const int64_t size = rng() % 100;
+        UserModel& m = (*models)[u];
+        bool expected, ok = false;
+        grpc::ClientContext ctx;
+        if (op < 4) {
+            expected = m.files.emplace(path, size).second;
+            if (stub) {
+                griddfs::CreateFileRequest req;
+                req.set_user_id(users[u]);
+                req.set_filename(path);
+                req.set_filesize(size);
+                griddfs::CreateFileResponse resp;
+                ok = stub->CreateFile(&ctx, req, &resp).ok();
+            }
+        } else if (op < 6) {
+            expected = m.files.erase(path) > 0;
+            if (stub) {
+                griddfs::DeleteFileRequest req;
+                req.set_user_id(users[u]);
+                req.set_filename(path);
+                griddfs::DeleteFileResponse resp;
+                ok = stub->DeleteFile(&ctx, req, &resp).ok() && resp.success();
+            }
+        } else if (op < 8) {
+            m.dirs.insert(path);
+            expected = true;
+            if (stub) {
+                griddfs::CreateDirectoryRequest req;
+                req.set_user_id(users[u]);
+                req.set_directory(path);
+                griddfs::CreateDirectoryResponse resp;
+                ok = stub->CreateDirectory(&ctx, req, &resp).ok() && resp.success();
+            }
+        } else {
+            expected = m.dirs.erase(path) > 0;
+            if (stub) {
+                griddfs::RemoveDirectoryRequest req;
+                req.set_user_id(users[u]);
+                req.set_directory(path);
+                griddfs::RemoveDirectoryResponse resp;
+                ok = stub->RemoveDirectory(&ctx, req, &resp).ok() && resp.success();
+            }
+        }
+        if (stub && ok != expected) ++mismatches;
+    }
+    return mismatches;
+}
+
+int RunListCheck(const Options& opts) {
+    const std::string target = opts.Str("target", "localhost:50050");
+    const std::string phase = opts.Str("phase", "all");
+    const unsigned seed = static_cast<unsigned>(opts.Int("seed", 1));
+    const long ops = std::max(0L, opts.Int("ops", 3000));
+    if (phase != "all" && phase != "ops" && phase != "list") return Usage();
+
+    // Usuarios fijos por semilla: la fase list los vuelve a encontrar tras
+    // reiniciar el NameNode
+    auto stub = Connect(target);
+    std::vector<std::string> users;
+    for (int u = 0; u < 3; ++u) {
+        const std::string name = "listcheck_" + std::to_string(seed) + "_" + std::to_string(u);
+        if (phase != "list") {
+            griddfs::RegisterUserRequest req;
+            req.set_username(name);
+            req.set_password("bench");
+            griddfs::RegisterUserResponse resp;
+            grpc::ClientContext ctx;
+            stub->RegisterUser(&ctx, req, &resp);
+        }
+        griddfs::LoginRequest req;
+        req.set_username(name);
+        req.set_password("bench");
+        griddfs::LoginResponse resp;
+        grpc::ClientContext ctx;
+        if (!stub->LoginUser(&ctx, req, &resp).ok() || !resp.success()) {
+            std::cerr << "no se pudo entrar como " << name << " en " << target << "\n";
+            return 1;
+        }
+        users.push_back(resp.user_id());
+    }
+    if (phase != "list" && !RegisterDataNodes(*stub, 3)) {
+        std::cerr << "no se pudieron registrar los DataNodes en " << target << "\n";
+        return 1;
+    }
+
+    std::vector<UserModel> models(users.size());
+    const size_t op_mismatches = ApplyListOps(phase == "list" ? nullptr : stub.get(), users, seed, ops, &models);
+
+    // Los fijos cubren la raíz, rutas relativas y componentes vacíos; además
+    // se lista cada directorio creado y el de cada archivo
+    std::set<std::string> dirs = {"/", "", "/a", "/a/b", "/a/", "a", "docs", "/docs", "/a//b", "/b/a"};
+    for (const UserModel& m : models) {
+        dirs.insert(m.dirs.begin(), m.dirs.end());
+        for (const auto& kv : m.files) {
+            const size_t slash = kv.first.rfind('/');
+            if (slash != std::string::npos) dirs.insert(kv.first.substr(0, slash));
+        }
+    }
+
+    size_t list_mismatches = 0, entries = 0;
+    for (size_t u = 0; u < users.size(); ++u) {
+        for (const std::string& d : dirs) {
+            griddfs::ListFilesRequest req;
+            req.set_user_id(users[u]);
+            req.set_directory(d);
+            griddfs::ListFilesResponse resp;
+            grpc::ClientContext ctx;
+            std::vector<std::string> got;
+            if (stub->ListFiles(&ctx, req, &resp).ok()) {
+                for (const auto& f : resp.files()) got.push_back(f.filename() + "|" + std::to_string(f.size()));
+            }
+            std::sort(got.begin(), got.end());
+            const std::vector<std::string> want = ModelList(models[u], d);
+            entries += want.size();
+            if (got == want) continue;
+            if (++list_mismatches <= 5) {
+                std::cerr << "ListFiles distinto: usuario " << u << " directorio '" << d << "' ("
+                          << got.size() << " entradas, se esperaban " << want.size() << ")\n";
+            }
+        }
+    }
+    std::cout << "[Bench] listcheck phase=" << phase << " seed=" << seed << " ops=" << ops
+              << " op_mismatches=" << op_mismatches << " lists=" << users.size() * dirs.size()
+              << " entries=" << entries << " list_mismatches=" << list_mismatches << std::endl;
+    return op_mismatches == 0 && list_mismatches == 0 ? 0 : 1;
+}
+
+int Usage() {
+    std::cerr << "uso: namenode_bench read|tail|heartbeat|blockreport|listcheck [--clave=valor ...] (ver namenode_bench.cc)\n";
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) return Usage();
+    const std::string mode = argv[1];
+    Options opts;
+    if (!opts.Parse(argc, argv, 2)) return Usage();
+    if (mode == "read") return RunRead(opts);
+    if (mode == "tail") return RunTail(opts);
+    if (mode == "heartbeat") return RunHeartbeat(opts);
+    if (mode == "blockreport") return RunBlockReport(opts);
+    if (mode == "listcheck") return RunListCheck(opts);
+    return Usage();
+}
@@ -1,13 +1,19 @@
 #include "namenode_server.h"
+#include "coding.h"
+#include "crc32c.h"
+#include "rcu.h"
+#include "lock_stats.h"
+#include "log.h"
+#include "fsimage.h"
 
-#include <iostream>
 #include <algorithm>
 #include <random>
 #include <sstream>
 #include <iomanip>
 #include <functional>
-#include <set>
-#include <fstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -55,9 +61,10 @@ const griddfs::DataNodeInfo& selectDataNodeHRW(const std::string& block_id,
 
 /**
  * Selecciona múltiples DataNodes para replicación usando HRW.
- * Retorna hasta 'count' DataNodes diferentes ordenados por peso HRW.
+ * Retorna las posiciones en 'datanodes' de hasta 'count' DataNodes
+ * diferentes, ordenados por peso HRW.
  */
-std::vector<griddfs::DataNodeInfo> selectDataNodesForReplication(
+std::vector<size_t> selectDataNodesForReplication(
     const std::string& block_id, 
     const std::vector<griddfs::DataNodeInfo>& datanodes,
     int count) {
@@ -75,20 +82,162 @@ std::vector<griddfs::DataNodeInfo> selectDataNodesForReplication(
               [](const auto& a, const auto& b) { return a.first > b.first; });
     
     // Seleccionar los primeros 'count' DataNodes
-    std::vector<griddfs::DataNodeInfo> selected;
+    std::vector<size_t> selected;
     int selected_count = std::min(count, static_cast<int>(datanodes.size()));
     selected.reserve(selected_count);
     for (int i = 0; i < selected_count; ++i) {
-        selected.push_back(datanodes[weights[i].second]);
+        selected.push_back(weights[i].second);
     }
     
     return selected;
 }
 
+/**
+ * Ids de los DataNodes separados por coma (para logs).
+ */
+std::string joinDataNodeIds(const google::protobuf::RepeatedPtrField<griddfs::DataNodeInfo>& datanodes) {
+    std::string ids;
+    for (int j = 0; j < datanodes.size(); ++j) {
+        if (j > 0) ids += ", ";
+        ids += datanodes[j].id();
+    }
+    return ids;
+}
+
+// =============================================
+// REGISTROS DEL EDIT LOG
+// =============================================
+
+// Tipo de registro (primer byte del payload). Todos fijan estado, así que
+// aplicarlos sobre un fsimage que ya incluye parte de ellos es inocuo.
+enum class EditOp : uint8_t {
+    kRegisterUser = 1,     // user_id, username, password_hash, created_ms
+    kCreateFile = 2,       // file_key, owner, size, created_ms, filename, bloques
+    kDeleteFile = 3,       // file_key
+    kCreateDirectory = 4,  // dir_key
+    kRemoveDirectory = 5,  // dir_key
+    kAddBlockLocation = 6, // file_key, índice de bloque, datanode_id, address
+};
+
+static int64_t ToMillis(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(t.time_since_epoch()).count();
+}
+
+static std::chrono::system_clock::time_point FromMillis(int64_t ms) {
+    return std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
+}
+
+/**
+ * Registro de alta de usuario.
+ */
+static std::string EncodeRegisterUser(const UserInfo& u) {
+    coding::Encoder e;
+    e.PutU8(static_cast<uint8_t>(EditOp::kRegisterUser));
+    e.PutString(u.user_id);
+    e.PutString(u.username);
+    e.PutString(u.password_hash);
+    e.PutSigned(ToMillis(u.created_time));
+    return e.Release();
+}
+
+/**
+ * Registro de archivo completo (metadatos, bloques y, si hay 'names',
+ * réplicas asignadas).
+ */
+static std::string EncodeCreateFile(const std::string& file_key, const FileMetadata& fm,
+                                    const DataNodeNames* names) {
+    coding::Encoder e;
+    e.PutU8(static_cast<uint8_t>(EditOp::kCreateFile));
+    e.PutString(file_key);
+    e.PutString(fm.owner_id());
+    e.PutSigned(fm.size);
+    e.PutSigned(ToMillis(fm.created_time));
+    e.PutString(fm.filename());
+    e.PutVarint(fm.blocks.size());
+    for (size_t i = 0; i < fm.blocks.size(); ++i) {
+        const BlockMeta& b = fm.blocks[i];
+        e.PutString(fm.BlockId(i));
+        e.PutSigned(b.size);
+        if (names == nullptr) {
+            e.PutVarint(0);
+            continue;
+        }
+        e.PutVarint(b.replicas.size());
+        for (NodeIndex node : b.replicas) {
+            std::string id, address;
+            names->Lookup(node, &id, &address);
+            e.PutString(id);
+            e.PutString(address);
+        }
+    }
+    return e.Release();
+}
+
+/**
+ * Registro de una operación que solo lleva clave (borrados y directorios).
+ */
+static std::string EncodeKeyOp(EditOp op, const std::string& key) {
+    coding::Encoder e;
+    e.PutU8(static_cast<uint8_t>(op));
+    e.PutString(key);
+    return e.Release();
+}
+
+/**
+ * Registro de una réplica nueva de un bloque (BlockReport).
+ */
+static std::string EncodeAddBlockLocation(const std::string& file_key, size_t block_idx,
+                                          const griddfs::DataNodeInfo& dn) {
+    coding::Encoder e;
+    e.PutU8(static_cast<uint8_t>(EditOp::kAddBlockLocation));
+    e.PutString(file_key);
+    e.PutVarint(block_idx);
+    e.PutString(dn.id());
+    e.PutString(dn.address());
+    return e.Release();
+}
+
+/**
+ * Clave ("user_id:...") sobre la que actúa un registro; false si no tiene
+ * (RegisterUser) o no se reconoce.
+ */
+static bool EditKey(const std::string& payload, std::string* key) {
+    coding::Decoder d(payload);
+    uint8_t op;
+    if (!d.GetU8(&op)) return false;
+    switch (static_cast<EditOp>(op)) {
+    case EditOp::kCreateFile:
+    case EditOp::kDeleteFile:
+    case EditOp::kCreateDirectory:
+    case EditOp::kRemoveDirectory:
+    case EditOp::kAddBlockLocation:
+        return d.GetString(key);
+    default:
+        return false;
+    }
+}
+
+// fsimage.img proyectado mientras quedan particiones sin cargar
+struct NameNodeServiceImpl::LazyImage {
+    fsimage::MappedFile file;
+    fsimage::ImageReader reader;
+    std::vector<std::vector<std::string>> pending;  // [shard] registros del edit log, en orden
+};
+
 // Constructor
 NameNodeServiceImpl::NameNodeServiceImpl() {
-    // registrar directorio raíz por defecto (opcional)
-    directories_.insert("/");
+    // número de particiones del espacio de nombres (fijo durante la vida del proceso)
+    size_t nshards = DEFAULT_NAMESPACE_SHARDS;
+    if (const char* n = std::getenv("GRIDDFS_NAMESPACE_SHARDS")) {
+        long v = std::strtol(n, nullptr, 10);
+        if (v >= 1 && v <= 4096) nshards = static_cast<size_t>(v);
+    }
+    shards_.reserve(nshards);
+    for (size_t i = 0; i < nshards; ++i) {
+        shards_.push_back(std::make_unique<NamespaceShard>());
+        shards_.back()->version.store(new ShardVersion());
+    }
+    users_.store(new UserTable());
 
     // inicializa meta_dir_ desde env (persistencia)
     if (const char* d = std::getenv("GRIDDFS_META_DIR")) {
@@ -98,9 +247,168 @@ NameNodeServiceImpl::NameNodeServiceImpl() {
     }
     ::mkdir(meta_dir_.c_str(), 0755);
 
-    // Carga snapshot si existe
-    std::lock_guard<std::mutex> lock(mu_);
-    (void)LoadSnapshotUnlocked();
+    // Durabilidad de las mutaciones (ver namenode_server.h)
+    if (const char* d = std::getenv("GRIDDFS_DURABILITY")) {
+        std::string mode = d;
+        if (mode == "async") durability_ = Durability::kAsync;
+        else if (mode != "sync") LOG_WARN("[NameNode] GRIDDFS_DURABILITY desconocido: " << mode << " (uso sync)");
+    }
+    if (const char* l = std::getenv("GRIDDFS_BLOCK_LOCATIONS")) {
+        std::string mode = l;
+        if (mode == "report") persist_locations_ = false;
+        else if (mode != "persist") LOG_WARN("[NameNode] GRIDDFS_BLOCK_LOCATIONS desconocido: " << mode << " (uso persist)");
+    }
+    if (const char* ms = std::getenv("GRIDDFS_CHECKPOINT_INTERVAL_MS")) {
+        long v = std::strtol(ms, nullptr, 10);
+        if (v > 0) checkpoint_interval_ = std::chrono::milliseconds(v);
+    }
+    if (const char* v = std::getenv("GRIDDFS_CHECKPOINT_TXNS")) {
+        long long n = std::strtoll(v, nullptr, 10);
+        if (n >= 0) checkpoint_txns_ = static_cast<uint64_t>(n);
+    }
+    if (const char* v = std::getenv("GRIDDFS_CHECKPOINT_EDITS_BYTES")) {
+        long long n = std::strtoll(v, nullptr, 10);
+        if (n >= 0) checkpoint_bytes_ = static_cast<uint64_t>(n);
+    }
+
+    // Hilos para guardar/cargar el fsimage por particiones
+    fsimage_threads_ = std::max(1u, std::thread::hardware_concurrency());
+    if (const char* v = std::getenv("GRIDDFS_FSIMAGE_THREADS")) {
+        long n = std::strtol(v, nullptr, 10);
+        if (n > 0 && n <= 1024) fsimage_threads_ = static_cast<unsigned>(n);
+    }
+    if (const char* v = std::getenv("GRIDDFS_FSIMAGE_ZSTD_LEVEL")) {
+        long n = std::strtol(v, nullptr, 10);
+        if (n >= 0 && n <= 19) fsimage_zstd_level_ = static_cast<int>(n);
+    }
+    if (const char* v = std::getenv("GRIDDFS_LAZY_LOAD")) lazy_load_ = std::string(v) == "1";
+
+    // Group commit del edit log: topes de lote y espera máxima del escritor
+    // (en async, el periodo de fdatasync)
+    if (const char* v = std::getenv("GRIDDFS_EDITLOG_BATCH_RECORDS")) {
+        long n = std::strtol(v, nullptr, 10);
+        if (n > 0) editlog_opts_.max_batch_records = static_cast<size_t>(n);
+    }
+    if (const char* v = std::getenv("GRIDDFS_EDITLOG_BATCH_BYTES")) {
+        long n = std::strtol(v, nullptr, 10);
+        if (n > 0) editlog_opts_.max_batch_bytes = static_cast<size_t>(n);
+    }
+    if (durability_ == Durability::kAsync) {
+        long ms = 1000;
+        if (const char* v = std::getenv("GRIDDFS_EDITLOG_FLUSH_MS")) ms = std::strtol(v, nullptr, 10);
+        if (ms > 0) editlog_opts_.max_delay = std::chrono::milliseconds(ms);
+    } else if (const char* v = std::getenv("GRIDDFS_EDITLOG_MAX_DELAY_US")) {
+        long us = std::strtol(v, nullptr, 10);
+        if (us >= 0) editlog_opts_.max_delay = std::chrono::microseconds(us);
+    }
+
+    // Carga snapshot si existe y aplica el edit log encima (aún no hay otros hilos)
+    if (!LoadSnapshotUnlocked()) {
+        // Arrancar vacío y hacer checkpoint perdería el espacio de nombres
+        LOG_ERROR("[NameNode] fsimage ilegible en " << meta_dir_ << "; se aborta el arranque");
+        logging::Shutdown();
+        std::exit(1);
+    }
+    uint64_t txid = 0;
+    if (!ReplayEditLogUnlocked(checkpoint_txid_.load(), &txid)) {
+        // Seguir perdería las mutaciones del log a partir del daño
+        LOG_ERROR("[NameNode] edit log dañado en " << meta_dir_ << "; se aborta el arranque");
+        logging::Shutdown();
+        std::exit(1);
+    }
+
+    // Índice de bloques de las particiones ya cargadas (las diferidas se
+    // indexan al materializarse)
+    const auto t_index = std::chrono::steady_clock::now();
+    fsimage::ParallelFor(shards_.size(), fsimage_threads_, [&](size_t i) {
+        if (shards_[i]->loaded.load()) IndexBlocks(*shards_[i]->version.load());
+    });
+    const double index_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_index).count();
+    const symbols::Stats sym = symbols::GetStats();
+    LOG_INFO("[Load] block_map blocks=" << block_map_.Size() << " index_ms=" << index_ms
+             << " symbols=" << sym.count << " symbol_bytes=" << sym.bytes);
+    if (!edit_log_.Open(meta_dir_, txid, editlog_opts_)) {
+        // Sin log ninguna mutación sería durable
+        LOG_ERROR("[NameNode] no se pudo abrir el edit log en " << meta_dir_ << "; se aborta el arranque");
+        logging::Shutdown();
+        std::exit(1);
+    }
+    LOG_INFO("[NameNode] namespace shards=" << shards_.size()
+             << " durability=" << (durability_ == Durability::kSync ? "sync" : "async")
+             << " block_locations=" << (persist_locations_ ? "persist" : "report")
+             << " checkpoint_interval_ms=" << checkpoint_interval_.count()
+             << " checkpoint_txns=" << checkpoint_txns_
+             << " checkpoint_edits_bytes=" << checkpoint_bytes_
+             << " fsimage_threads=" << fsimage_threads_
+             << " fsimage_zstd_level=" << fsimage_zstd_level_
+             << " lazy_load=" << (lazy_ ? 1 : 0)
+             << " crc32c=" << (crc32c::Accelerated() ? "hw" : "sw")
+             << " editlog_batch=" << editlog_opts_.max_batch_records << "rec/"
+             << editlog_opts_.max_batch_bytes << "B"
+             << " editlog_max_delay_us=" << editlog_opts_.max_delay.count()
+             << " txid=" << txid);
+
+    // Un log largo (p. ej. tras una caída) se compacta sin esperar al periodo
+    if (CheckpointDue(txid) != nullptr) checkpoint_requested_ = true;
+    checkpointer_ = std::thread(&NameNodeServiceImpl::CheckpointLoop, this);
+    if (lazy_) warmup_ = std::thread(&NameNodeServiceImpl::WarmupLoop, this);
+
+    // Volcado periódico de estadísticas (0 = solo al apagar)
+    long stats_s = 60;
+    if (const char* v = std::getenv("GRIDDFS_LOCK_STATS_INTERVAL_S")) {
+        stats_s = std::strtol(v, nullptr, 10);
+    }
+    lockstats::StartPeriodicDump(std::chrono::seconds(stats_s),
+                                 [this](std::ostream& os) { DumpStats(os); });
+}
+
+NameNodeServiceImpl::~NameNodeServiceImpl() {
+    // El checkpoint final carga lo que falte; no hace falta esperar al resto
+    warmup_stop_ = true;
+    if (warmup_.joinable()) warmup_.join();
+
+    // Último checkpoint con lo pendiente y parada del hilo
+    {
+        std::lock_guard<std::mutex> lock(ckpt_mu_);
+        stopping_ = true;
+    }
+    ckpt_cv_.notify_one();
+    if (checkpointer_.joinable()) checkpointer_.join();
+    edit_log_.Close();
+
+    lockstats::StopPeriodicDump();
+    std::ostringstream stats;
+    DumpStats(stats);
+    LOG_INFO(stats.str());
+
+    // El servidor ya se detuvo: no quedan lectores de las versiones actuales
+    for (auto& shard : shards_) delete shard->version.load();
+    delete users_.load();
+}
+
+// =============================================
+// VERSIONES INMUTABLES DEL ESPACIO DE NOMBRES
+// =============================================
+
+void ShardVersion::PutFile(const std::string& file_key, std::shared_ptr<const FileMetadata> fm) {
+    if (files.Put(file_key, std::move(fm))) tree.AddFile(file_key);
+}
+
+void ShardVersion::EraseFile(const std::string& file_key) {
+    if (files.Erase(file_key)) tree.RemoveFile(file_key);
+}
+
+void ShardVersion::PutDirectory(const std::string& dir_key) {
+    tree.AddDirectory(dir_key);
+}
+
+void ShardVersion::EraseDirectory(const std::string& dir_key) {
+    tree.RemoveDirectory(dir_key);
+}
+
+void NameNodeServiceImpl::PublishVersion(NamespaceShard& shard, const ShardVersion* next) {
+    const ShardVersion* prev = shard.version.exchange(next);
+    shard.retired.Retire(prev);
 }
 
 // =============================================
@@ -133,21 +441,29 @@ bool NameNodeServiceImpl::verifyPassword(const std::string& password, const std:
 }
 
 bool NameNodeServiceImpl::userExists(const std::string& username) {
-    return users_.find(username) != users_.end();
+    rcu::ReadGuard guard;
+    const UserTable* users = users_.load();
+    return users->by_name.find(username) != users->by_name.end();
 }
 
 bool NameNodeServiceImpl::isFileOwner(const std::string& filename, const std::string& user_id) {
     // Crear clave única por usuario: user_id + ":" + filename
     std::string file_key = user_id + ":" + filename;
-    auto it = files_.find(file_key);
-    if (it == files_.end()) return false;
-    return it->second.owner_id == user_id;
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return false;
+    rcu::ReadGuard guard;
+    const FileMetadata* fm = shard->version.load()->FindFile(file_key);
+    return fm != nullptr && fm->owner_id() == user_id;
 }
 
 bool NameNodeServiceImpl::isValidUser(const std::string& user_id) {
-    return users_by_id_.find(user_id) != users_by_id_.end();
+    rcu::ReadGuard guard;
+    const UserTable* users = users_.load();
+    return users->by_id.find(user_id) != users->by_id.end();
 }
 
+
+
 // =============================================
 // SERVICIOS DE AUTENTICACIÓN
 // =============================================
@@ -155,7 +471,8 @@ bool NameNodeServiceImpl::isValidUser(const std::string& user_id) {
 Status NameNodeServiceImpl::RegisterUser(ServerContext* /*ctx*/,
                                          const griddfs::RegisterUserRequest* request,
                                          griddfs::RegisterUserResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
+    static lockstats::Site site("RegisterUser", "mu_");
+    lockstats::TimedLock<std::mutex> lock(mu_, site);
     
     const std::string& username = request->username();
     const std::string& password = request->password();
@@ -181,33 +498,36 @@ Status NameNodeServiceImpl::RegisterUser(ServerContext* /*ctx*/,
     user.password_hash = hashPassword(password);
     user.created_time = std::chrono::system_clock::now();
     
-    // Guardar usuario
-    users_[username] = user;
-    users_by_id_[user.user_id] = user;
+    // Guardar usuario: publica una tabla nueva con el usuario añadido
+    auto next = std::make_unique<UserTable>(*users_.load());
+    next->by_name[username] = user;
+    next->by_id[user.user_id] = user;
+    users_retired_.Retire(users_.exchange(next.release()));
+    const uint64_t txid = edit_log_.Append(EncodeRegisterUser(user));
     
     response->set_success(true);
     response->set_user_id(user.user_id);
     response->set_message("Usuario registrado exitosamente");
     
-    std::cout << "[RegisterUser] " << username << " -> " << user.user_id << std::endl;
+    LOG_INFO("[RegisterUser] " << username << " -> " << user.user_id);
 
     // >>> Persistencia
-    (void)SaveSnapshotUnlocked();
-    
-    return Status::OK;
+    lock.unlock();
+    return CommitMutation(txid);
 }
 
 Status NameNodeServiceImpl::LoginUser(ServerContext* /*ctx*/,
                                      const griddfs::LoginRequest* request,
                                      griddfs::LoginResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
+    rcu::ReadGuard guard;  // solo lectura, sin locks
+    const UserTable* users = users_.load();
     
     const std::string& username = request->username();
     const std::string& password = request->password();
     
     // Buscar usuario
-    auto it = users_.find(username);
-    if (it == users_.end()) {
+    auto it = users->by_name.find(username);
+    if (it == users->by_name.end()) {
         response->set_success(false);
         response->set_message("Usuario no encontrado");
         return Status::OK;
@@ -226,7 +546,7 @@ Status NameNodeServiceImpl::LoginUser(ServerContext* /*ctx*/,
     response->set_user_id(user.user_id);
     response->set_message("Login exitoso");
     
-    std::cout << "[LoginUser] " << username << " -> " << user.user_id << std::endl;
+    LOG_INFO("[LoginUser] " << username << " -> " << user.user_id);
     
     return Status::OK;
 }
@@ -239,8 +559,6 @@ Status NameNodeServiceImpl::LoginUser(ServerContext* /*ctx*/,
 Status NameNodeServiceImpl::CreateFile(ServerContext* /*ctx*/,
                                        const griddfs::CreateFileRequest* request,
                                        griddfs::CreateFileResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
     const std::string& filename = request->filename();
     const int64_t filesize = request->filesize();
     const std::string& user_id = request->user_id();
@@ -249,32 +567,36 @@ Status NameNodeServiceImpl::CreateFile(ServerContext* /*ctx*/,
     if (!isValidUser(user_id)) {
         return Status(grpc::StatusCode::UNAUTHENTICATED, "Usuario no válido");
     }
+
+    // Vista consistente de los DataNodes para HRW (sin locks)
+    std::vector<NodeIndex> dn_index;
+    std::vector<griddfs::DataNodeInfo> dns = datanodes_.Snapshot(&dn_index);
     
     // Crear clave única por usuario: user_id + ":" + filename
     std::string file_key = user_id + ":" + filename;
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+    static lockstats::Site site("CreateFile", "shard->mu");
+    lockstats::TimedLock<std::mutex> lock(shard->mu, site);
+    const ShardVersion* cur = shard->version.load();
     
     // Verificar si el archivo ya existe para este usuario
-    if (files_.find(file_key) != files_.end()) {
+    if (cur->FindFile(file_key) != nullptr) {
         return Status(grpc::StatusCode::ALREADY_EXISTS, "El archivo ya existe");
     }
 
-    if (datanodes_.empty()) {
+    if (dns.empty()) {
         return Status(grpc::StatusCode::FAILED_PRECONDITION, "No hay DataNodes registrados");
     }
 
-    // Construir vector de DataNodeInfo para HRW
-    std::vector<griddfs::DataNodeInfo> dns;
-    dns.reserve(datanodes_.size());
-    for (const auto& kv : datanodes_) dns.push_back(kv.second);
-
     const int64_t block_size = DEFAULT_BLOCK_SIZE;
     int64_t nblocks = (filesize + block_size - 1) / block_size;
     if (nblocks <= 0) nblocks = 1; // manejar archivos con tamaño 0
 
     // Crear metadata del archivo
     FileMetadata file_meta;
-    file_meta.filename = filename;  // Guardamos solo el nombre del archivo, no la clave
-    file_meta.owner_id = user_id;
+    file_meta.SetFilename(filename);  // Guardamos solo el nombre del archivo, no la clave
+    file_meta.SetOwner(user_id);
     file_meta.size = filesize;
     file_meta.created_time = std::chrono::system_clock::now();
 
@@ -287,46 +609,49 @@ Status NameNodeServiceImpl::CreateFile(ServerContext* /*ctx*/,
         bi.set_size(this_size);
 
         // Asignar múltiples DataNodes para replicación usando HRW
-        std::vector<griddfs::DataNodeInfo> replicas = selectDataNodesForReplication(
+        std::vector<size_t> replicas = selectDataNodesForReplication(
             bi.block_id(), dns, REPLICATION_FACTOR);
         
-        // Añadir todas las réplicas al bloque
-        for (const auto& replica : replicas) {
+        // Añadir todas las réplicas al bloque (en metadatos, solo el índice
+        // del nodo en el registro)
+        BlockMeta block;  // block_id por defecto: no se guarda
+        block.size = this_size;
+        for (size_t pos : replicas) {
             griddfs::DataNodeInfo* dn_ptr = bi.add_datanodes();
-            dn_ptr->CopyFrom(replica);
+            dn_ptr->CopyFrom(dns[pos]);
+            block.replicas.push_back(dn_index[pos]);
         }
 
         // Guardar en metadata del archivo
-        file_meta.blocks.push_back(bi);
+        file_meta.blocks.push_back(std::move(block));
 
         // Añadir al response
         griddfs::BlockInfo* out_bi = const_cast<griddfs::CreateFileResponse*>(response)->add_blocks();
         out_bi->CopyFrom(bi);
 
-        std::cout << "[CreateFile] " << filename << " (owner: " << user_id << ") -> block " << bi.block_id()
-                  << " size=" << bi.size() << " assigned to " << replicas.size() << " DataNodes: ";
-        for (size_t j = 0; j < replicas.size(); ++j) {
-            std::cout << replicas[j].id();
-            if (j < replicas.size() - 1) std::cout << ", ";
-        }
-        std::cout << " (HRW+Replication)" << "\n";
+        LOG_INFO("[CreateFile] " << filename << " (owner: " << user_id << ") -> block " << bi.block_id()
+                 << " size=" << bi.size() << " assigned to " << replicas.size() << " DataNodes: "
+                 << joinDataNodeIds(bi.datanodes()) << " (HRW+Replication)");
     }
     
-    // Guardar metadata del archivo con clave única
-    files_[file_key] = file_meta;
+    // Guardar metadata del archivo con clave única (nueva versión de la partición)
+    const std::string record = EncodeCreateFile(file_key, file_meta, persist_locations_ ? &datanodes_ : nullptr);
+    auto fm = std::make_shared<const FileMetadata>(std::move(file_meta));
+    block_map_.AddFile(file_key, *fm);
+    auto next = std::make_unique<ShardVersion>(*cur);
+    next->PutFile(file_key, std::move(fm));
+    PublishVersion(*shard, next.release());
+    const uint64_t txid = edit_log_.Append(record);
 
     // >>> Persistencia
-    (void)SaveSnapshotUnlocked();
-
-    return Status::OK;
+    lock.unlock();
+    return CommitMutation(txid);
 }
 
 // GetFileInfo: devolvemos la lista de BlockInfo guardada previamente
 Status NameNodeServiceImpl::GetFileInfo(ServerContext* /*ctx*/,
                                         const griddfs::GetFileInfoRequest* request,
                                         griddfs::GetFileInfoResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
     const std::string& filename = request->filename();
     const std::string& user_id = request->user_id();
     
@@ -337,25 +662,31 @@ Status NameNodeServiceImpl::GetFileInfo(ServerContext* /*ctx*/,
     
     // Crear clave única por usuario: user_id + ":" + filename
     std::string file_key = user_id + ":" + filename;
-    
-    auto it = files_.find(file_key);
-    if (it == files_.end()) {
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+    rcu::ReadGuard guard;  // solo lectura, sin locks
+    const FileMetadata* found = shard->version.load()->FindFile(file_key);
+    if (found == nullptr) {
         return Status(grpc::StatusCode::NOT_FOUND, "Archivo no encontrado");
     }
     
-    const FileMetadata& file_meta = it->second;
+    const FileMetadata& file_meta = *found;
     
     // Añadir bloques al response
-    for (const griddfs::BlockInfo& bi : file_meta.blocks) {
+    // Las réplicas se expanden con el estado actual de cada DataNode
+    for (size_t i = 0; i < file_meta.blocks.size(); ++i) {
+        const BlockMeta& b = file_meta.blocks[i];
         griddfs::BlockInfo* out_bi = response->add_blocks();
-        out_bi->CopyFrom(bi);
+        file_meta.BlockId(i, out_bi->mutable_block_id());
+        out_bi->set_size(b.size);
+        for (NodeIndex node : b.replicas) datanodes_.Expand(node, out_bi->add_datanodes());
     }
     
     // Establecer propietario
-    response->set_owner_id(file_meta.owner_id);
+    response->set_owner_id(file_meta.owner_id());
 
-    std::cout << "[GetFileInfo] " << filename << " (owner: " << file_meta.owner_id << ") -> " 
-              << file_meta.blocks.size() << " blocks\n";
+    LOG_INFO("[GetFileInfo] " << filename << " (owner: " << file_meta.owner_id() << ") -> " 
+             << file_meta.blocks.size() << " blocks");
     return Status::OK;
 }
 
@@ -363,8 +694,6 @@ Status NameNodeServiceImpl::GetFileInfo(ServerContext* /*ctx*/,
 Status NameNodeServiceImpl::ListFiles(ServerContext* /*ctx*/,
                                       const griddfs::ListFilesRequest* request,
                                       griddfs::ListFilesResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
     const std::string& dir = request->directory();
     const std::string& user_id = request->user_id();
     
@@ -373,147 +702,48 @@ Status NameNodeServiceImpl::ListFiles(ServerContext* /*ctx*/,
         return Status(grpc::StatusCode::UNAUTHENTICATED, "Usuario no válido");
     }
 
-    // Primero recopilar directorios únicos del usuario basado en sus archivos
-    std::set<std::string> user_directories;
-    
-    // 1. Agregar directorios creados explícitamente por el usuario
-    std::string dir_prefix = user_id + ":";
-    for (const auto& directory_key : directories_) {
-        std::cout << "[DEBUG] Checking directory_key: '" << directory_key << "' against prefix: '" << dir_prefix << "'\n";
-        if (starts_with(directory_key, dir_prefix)) {
-            // Extraer el directorio real (sin el user_id)
-            std::string actual_dir = directory_key.substr(dir_prefix.length());
-            std::cout << "[DEBUG] Adding explicit directory: '" << actual_dir << "' to user_directories\n";
-            user_directories.insert(actual_dir);
-        }
-    }
-    
-    // 2. Agregar directorios derivados de archivos del usuario
-    for (const auto& kv : files_) {
-        const std::string& dir_file_key = kv.first;
-        
-        // Verificar si el archivo pertenece al usuario actual
-        std::string file_prefix = user_id + ":";
-        if (!starts_with(dir_file_key, file_prefix)) {
-            continue;
-        }
-        
-        // Extraer el nombre del archivo real (sin el user_id)
-        std::string dir_filename = dir_file_key.substr(file_prefix.length());
-        
-        // Extraer directorios de este archivo
-        std::string current_path = dir_filename;
-        while (current_path.find('/') != std::string::npos) {
-            size_t last_slash = current_path.find_last_of('/');
-            if (last_slash != std::string::npos) {
-                current_path = current_path.substr(0, last_slash);
-                if (!current_path.empty()) {
-                    user_directories.insert(current_path);
-                }
-            }
-        }
-    }
-    
-    // Luego agregar directorios del usuario
-    std::cout << "[DEBUG] user_directories contains " << user_directories.size() << " directories\n";
-    for (const auto& directory : user_directories) {
-        std::cout << "[DEBUG] Processing directory: '" << directory << "' for listing in '" << dir << "'\n";
-        // Verificar si el directorio debería mostrarse en este nivel
-        bool should_include_dir = false;
-        std::string display_name;
-        
-        if (dir == "/") {
-            // En directorio raíz, mostrar directorios de primer nivel
-            if (directory.length() > 1 && directory[0] == '/') {
-                // Es un directorio absoluto como "/fotos"
-                std::string subdir = directory.substr(1); // quitar el "/" inicial
-                if (subdir.find('/') == std::string::npos && !subdir.empty()) {
-                    should_include_dir = true;
-                    display_name = subdir;
-                    std::cout << "[DEBUG] Will show directory '" << display_name << "' in root\n";
-                }
-            }
-        } else {
-            // En otros directorios, mostrar subdirectorios
-            std::string prefix = dir + "/";
-            if (starts_with(directory, prefix)) {
-                std::string subdir = directory.substr(prefix.length());
-                if (subdir.find('/') == std::string::npos && !subdir.empty()) {
-                    should_include_dir = true;
-                    display_name = subdir;
-                }
-            }
-        }
-        
-        if (should_include_dir) {
-            griddfs::FileMetadata* dir_info = response->add_files();
-            dir_info->set_filename("📁 " + display_name);  // Marcar como directorio con emoji
-            dir_info->set_owner_id(user_id);  // Los directorios pertenecen al usuario que los creó
-            dir_info->set_size(0);  // Los directorios tienen tamaño 0
-            dir_info->set_created_time(0);  // Por simplicidad, timestamp 0 para directorios
-        }
+    // Solo la partición del usuario contiene sus archivos y directorios; el
+    // árbol da los hijos de 'dir' sin recorrer el resto del espacio de nombres
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+    rcu::ReadGuard guard;  // solo lectura, sin locks
+    const ShardVersion* version = shard->version.load();
+    const std::string dir_key = user_id + ":" + (dir == "/" ? std::string() : dir);
+    std::vector<std::string> subdirs, names;
+    version->tree.List(dir_key, &subdirs, &names);
+
+    // Primero los directorios (creados explícitamente o con archivos debajo)
+    for (const std::string& name : subdirs) {
+        griddfs::FileMetadata* dir_info = response->add_files();
+        dir_info->set_filename("📁 " + name);  // Marcar como directorio con emoji
+        dir_info->set_owner_id(user_id);  // Los directorios pertenecen al usuario que los creó
+        dir_info->set_size(0);  // Los directorios tienen tamaño 0
+        dir_info->set_created_time(0);  // Por simplicidad, timestamp 0 para directorios
     }
 
-    // Luego agregar archivos
-    for (const auto& kv : files_) {
-        const std::string& file_key = kv.first;
-        const FileMetadata& file_meta = kv.second;
-        
-        // Verificar si el archivo pertenece al usuario actual
-        // El file_key tiene formato "user_id:filename"
-        std::string prefix = user_id + ":";
-        if (!starts_with(file_key, prefix)) {
-            continue; // Este archivo no pertenece al usuario actual
-        }
-        
-        // Extraer el nombre del archivo real (sin el user_id)
-        std::string filename = file_key.substr(prefix.length());
-        
-        // Si el directorio es "/", mostrar todos los archivos que no contengan "/"
-        // Si es otro directorio, usar starts_with normal
-        bool should_include = false;
-        if (dir == "/") {
-            // Para directorio raíz, incluir archivos que empiecen con "/" y no tengan más "/"
-            if (filename.length() > 1 && filename[0] == '/') {
-                std::string name_without_slash = filename.substr(1); // quitar "/" inicial
-                should_include = (name_without_slash.find('/') == std::string::npos);
-            }
-        } else {
-            // Para otros directorios, verificar si el archivo está en este directorio
-            std::string dir_prefix = dir + "/";
-            if (starts_with(filename, dir_prefix)) {
-                std::string relative_filename = filename.substr(dir_prefix.length());
-                should_include = (relative_filename.find('/') == std::string::npos);
-            }
-        }
-        
-        if (should_include) {
-            griddfs::FileMetadata* file_info = response->add_files();
-            if (dir == "/") {
-                // En raíz, mostrar nombre sin "/" inicial
-                if (filename.length() > 1 && filename[0] == '/') {
-                    file_info->set_filename(filename.substr(1));  // quitar "/" inicial
-                } else {
-                    file_info->set_filename(filename);
-                }
-            } else {
-                // En subdirectorios, mostrar solo el nombre relativo
-                std::string dir_prefix = dir + "/";
-                std::string relative_filename = filename.substr(dir_prefix.length());
-                file_info->set_filename(relative_filename);
-            }
-            file_info->set_owner_id(file_meta.owner_id);
-            file_info->set_size(file_meta.size);
-            
-            // Convertir timestamp a epoch milliseconds
-            auto epoch = file_meta.created_time.time_since_epoch();
-            auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
-            file_info->set_created_time(millis);
-        }
+    // Luego los archivos, con sus metadatos por file_key
+    std::string file_key = dir_key + "/";
+    const size_t prefix_len = file_key.size();
+    for (const std::string& name : names) {
+        if (name.empty() && dir == "/") continue;  // el archivo "/" no se lista en la raíz
+        file_key.resize(prefix_len);
+        file_key += name;
+        const FileMetadata* file_meta = version->FindFile(file_key);
+        if (file_meta == nullptr) continue;
+
+        griddfs::FileMetadata* file_info = response->add_files();
+        file_info->set_filename(name);
+        file_info->set_owner_id(file_meta->owner_id());
+        file_info->set_size(file_meta->size);
+
+        // Convertir timestamp a epoch milliseconds
+        auto epoch = file_meta->created_time.time_since_epoch();
+        auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(epoch).count();
+        file_info->set_created_time(millis);
     }
 
-    std::cout << "[ListFiles] directory='" << dir << "' user=" << user_id 
-              << " -> " << response->files_size() << " files\n";
+    LOG_INFO("[ListFiles] directory='" << dir << "' user=" << user_id 
+             << " -> " << response->files_size() << " files");
     return Status::OK;
 }
 
@@ -521,8 +751,6 @@ Status NameNodeServiceImpl::ListFiles(ServerContext* /*ctx*/,
 Status NameNodeServiceImpl::DeleteFile(ServerContext* /*ctx*/,
                                        const griddfs::DeleteFileRequest* request,
                                        griddfs::DeleteFileResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
     const std::string& filename = request->filename();
     const std::string& user_id = request->user_id();
     
@@ -535,33 +763,39 @@ Status NameNodeServiceImpl::DeleteFile(ServerContext* /*ctx*/,
     
     // Crear clave única por usuario: user_id + ":" + filename
     std::string file_key = user_id + ":" + filename;
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+    static lockstats::Site site("DeleteFile", "shard->mu");
+    lockstats::TimedLock<std::mutex> lock(shard->mu, site);
+    const ShardVersion* cur = shard->version.load();
     
-    auto it = files_.find(file_key);
-    if (it == files_.end()) {
+    const FileMetadata* existing = cur->FindFile(file_key);
+    if (existing == nullptr) {
         response->set_success(false);
         response->set_message("Archivo no encontrado");
         return Status::OK;
     }
     
     // Eliminar archivo
-    files_.erase(it);
+    block_map_.RemoveFile(file_key, *existing);
+    auto next = std::make_unique<ShardVersion>(*cur);
+    next->EraseFile(file_key);
+    PublishVersion(*shard, next.release());
+    const uint64_t txid = edit_log_.Append(EncodeKeyOp(EditOp::kDeleteFile, file_key));
     response->set_success(true);
     response->set_message("Archivo eliminado exitosamente");
     
-    std::cout << "[DeleteFile] " << filename << " eliminado por " << user_id << std::endl;
+    LOG_INFO("[DeleteFile] " << filename << " eliminado por " << user_id);
 
     // >>> Persistencia
-    (void)SaveSnapshotUnlocked();
-
-    return Status::OK;
+    lock.unlock();
+    return CommitMutation(txid);
 }
 
 // CreateDirectory: versión con autenticación
 Status NameNodeServiceImpl::CreateDirectory(ServerContext* /*ctx*/,
                                             const griddfs::CreateDirectoryRequest* request,
                                             griddfs::CreateDirectoryResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
     const std::string& dir = request->directory();
     const std::string& user_id = request->user_id();
     
@@ -573,23 +807,29 @@ Status NameNodeServiceImpl::CreateDirectory(ServerContext* /*ctx*/,
     
     // Crear clave única por usuario para el directorio
     std::string dir_key = user_id + ":" + dir;
-    std::cout << "[DEBUG] CreateDirectory storing key: '" << dir_key << "'\n";
-    directories_.insert(dir_key);
+    LOG_DEBUG("[DEBUG] CreateDirectory storing key: '" << dir_key << "'");
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+    uint64_t txid;
+    {
+        static lockstats::Site site("CreateDirectory", "shard->mu");
+        lockstats::TimedLock<std::mutex> lock(shard->mu, site);
+        auto next = std::make_unique<ShardVersion>(*shard->version.load());
+        next->PutDirectory(dir_key);
+        PublishVersion(*shard, next.release());
+        txid = edit_log_.Append(EncodeKeyOp(EditOp::kCreateDirectory, dir_key));
+    }
     response->set_success(true);
-    std::cout << "[CreateDirectory] " << dir << " creado por " << user_id << std::endl;
+    LOG_INFO("[CreateDirectory] " << dir << " creado por " << user_id);
 
     // >>> Persistencia
-    (void)SaveSnapshotUnlocked();
-
-    return Status::OK;
+    return CommitMutation(txid);
 }
 
 // RemoveDirectory: eliminar directorio con autenticación
 Status NameNodeServiceImpl::RemoveDirectory(ServerContext* /*ctx*/,
                                             const griddfs::RemoveDirectoryRequest* request,
                                             griddfs::RemoveDirectoryResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-    
     const std::string& dir = request->directory();
     const std::string& user_id = request->user_id();
     
@@ -601,21 +841,28 @@ Status NameNodeServiceImpl::RemoveDirectory(ServerContext* /*ctx*/,
     
     // Crear clave única por usuario para el directorio
     std::string dir_key = user_id + ":" + dir;
+    NamespaceShard* shard = ShardFor(user_id);
+    if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+    static lockstats::Site site("RemoveDirectory", "shard->mu");
+    lockstats::TimedLock<std::mutex> lock(shard->mu, site);
+    const ShardVersion* cur = shard->version.load();
     
     // Verificar que el directorio existe
-    if (directories_.find(dir_key) == directories_.end()) {
+    if (!cur->tree.IsDirectory(dir_key)) {
         response->set_success(false);
         return Status(grpc::StatusCode::NOT_FOUND, "Directorio no encontrado");
     }
     
-    directories_.erase(dir_key);
+    auto next = std::make_unique<ShardVersion>(*cur);
+    next->EraseDirectory(dir_key);
+    PublishVersion(*shard, next.release());
+    const uint64_t txid = edit_log_.Append(EncodeKeyOp(EditOp::kRemoveDirectory, dir_key));
     response->set_success(true);
-    std::cout << "[RemoveDirectory] " << dir << " eliminado por " << user_id << std::endl;
+    LOG_INFO("[RemoveDirectory] " << dir << " eliminado por " << user_id);
 
     // >>> Persistencia
-    (void)SaveSnapshotUnlocked();
-
-    return Status::OK;
+    lock.unlock();
+    return CommitMutation(txid);
 }
 
 // =============================================
@@ -626,8 +873,6 @@ Status NameNodeServiceImpl::RemoveDirectory(ServerContext* /*ctx*/,
 Status NameNodeServiceImpl::RegisterDataNode(ServerContext* ctx,
                                              const griddfs::RegisterDataNodeRequest* request,
                                              griddfs::RegisterDataNodeResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
-
     const griddfs::DataNodeInfo& in = request->datanode();
     std::string id = in.id();
 
@@ -638,13 +883,13 @@ Status NameNodeServiceImpl::RegisterDataNode(ServerContext* ctx,
     // Guarda el DN con la dirección corregida (no localhost)
     griddfs::DataNodeInfo dn = in;
     dn.set_address(fixed_addr);
-    datanodes_[id] = dn;
+    datanodes_.Register(dn);
 
     response->set_success(true);
-    std::cout << "[RegisterDataNode] id=" << id
-              << " addr=" << dn.address()
-              << " capacity=" << dn.capacity()
-              << " free=" << dn.free_space() << "\n";
+    LOG_INFO("[RegisterDataNode] id=" << id
+             << " addr=" << dn.address()
+             << " capacity=" << dn.capacity()
+             << " free=" << dn.free_space());
     return Status::OK;
 }
 
@@ -652,19 +897,16 @@ Status NameNodeServiceImpl::RegisterDataNode(ServerContext* ctx,
 Status NameNodeServiceImpl::Heartbeat(ServerContext* /*ctx*/,
                                       const griddfs::HeartbeatRequest* request,
                                       griddfs::HeartbeatResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
     const std::string id = request->datanode_id();
-    auto it = datanodes_.find(id);
-    if (it != datanodes_.end()) {
-        // actualizar free_space si el DataNode ya estaba registrado
-        it->second.set_free_space(request->free_space());
+    // Sin locks: solo actualiza las estadísticas atómicas del nodo
+    if (datanodes_.Heartbeat(id, request->free_space())) {
         response->set_success(true);
-        std::cout << "[Heartbeat] from " << id << " free_space=" << request->free_space() << "\n";
+        LOG_DEBUG("[Heartbeat] from " << id << " free_space=" << request->free_space());
         return Status::OK;
     } else {
         // No estaba registrado -> false (el cliente puede llamar RegisterDataNode primero)
         response->set_success(false);
-        std::cout << "[Heartbeat] unknown DataNode " << id << "\n";
+        LOG_WARN("[Heartbeat] unknown DataNode " << id);
         return Status::OK;
     }
 }
@@ -673,53 +915,119 @@ Status NameNodeServiceImpl::Heartbeat(ServerContext* /*ctx*/,
 Status NameNodeServiceImpl::BlockReport(ServerContext* /*ctx*/,
                                         const griddfs::BlockReportRequest* request,
                                         griddfs::BlockReportResponse* response) {
-    std::lock_guard<std::mutex> lock(mu_);
     const std::string id = request->datanode_id();
-    auto it_dn = datanodes_.find(id);
-    if (it_dn == datanodes_.end()) {
+    griddfs::DataNodeInfo dn_info;
+    NodeIndex node;
+    if (!datanodes_.Find(id, &dn_info, &node)) {
         response->set_success(false);
-        std::cout << "[BlockReport] from unknown datanode " << id << "\n";
+        LOG_WARN("[BlockReport] from unknown datanode " << id);
         return Status::OK;
     }
 
-    const griddfs::DataNodeInfo& dn_info = it_dn->second;
-
-    bool changed = false;
-
-    // Para cada block_id reportado, intentamos asociar este DataNode al BlockInfo en files_
+    uint64_t last_txid = 0;  // último registro añadido (0 = sin cambios)
+    bool lost = false;       // algún registro no entró en el log
+    size_t added = 0;
+    size_t matched = 0;   // bloques reportados que están en metadatos
+    size_t deferred = 0;  // en particiones aún sin cargar (quizá)
+
+    // El índice global dice en qué archivo (y partición) está cada bloque;
+    // se agrupan por partición y cada una publica a lo sumo una versión
+    // nueva con todos los archivos que cambiaron. Con carga diferida, el
+    // índice solo cubre las particiones ya cargadas: el coste depende del
+    // tamaño del reporte, no del espacio de nombres.
+    struct Located {
+        const std::string* block_id;
+        BlockMap::Ref ref;
+    };
+    std::vector<std::vector<Located>> by_shard(shards_.size());
+    std::vector<BlockMap::Ref> candidates;
+    auto locate = [&](const std::string& blk_id) {
+        candidates.clear();
+        if (!block_map_.Find(blk_id, &candidates)) return false;
+        for (BlockMap::Ref& ref : candidates) {
+            const std::string_view key = ref.file_key;
+            const size_t shard_idx = ShardIndex(key.substr(0, key.find(':')));
+            by_shard[shard_idx].push_back({&blk_id, std::move(ref)});
+        }
+        return true;
+    };
+    // Leído antes de buscar: si ya no quedaban particiones sin cargar, todas
+    // estaban indexadas y lo que no aparezca es desconocido
+    const bool lazy = unloaded_shards_.load() > 0;
+    std::vector<const std::string*> missing;
     for (const std::string& blk_id : request->block_ids()) {
-        bool found = false;
-        for (auto& kv : files_) {
-            FileMetadata& file_meta = kv.second;
-            for (auto& bi : file_meta.blocks) {
-                if (bi.block_id() == blk_id) {
-                    found = true;
-                    // comprobar si ya existe el datanode en la lista
-                    bool already = false;
-                    for (const auto& existing_dn : bi.datanodes()) {
-                        if (existing_dn.id() == id) {
-                            already = true;
-                            break;
-                        }
-                    }
-                    if (!already) {
-                        griddfs::DataNodeInfo* newdn = bi.add_datanodes();
-                        newdn->CopyFrom(dn_info);
-                        changed = true;
-                        std::cout << "[BlockReport] asociando block " << blk_id << " -> datanode " << id << "\n";
-                    }
+        if (!locate(blk_id)) missing.push_back(&blk_id);
+    }
+    if (lazy && !missing.empty()) {
+        // Se vuelve a buscar con deferred_mu_: una partición pudo indexarse
+        // entre medias, y si no, MaterializeShard verá la réplica pendiente
+        std::lock_guard<std::mutex> dlock(deferred_mu_);
+        for (const std::string* blk_id : missing) {
+            if (locate(*blk_id) || unloaded_shards_.load() == 0) continue;
+            std::vector<NodeIndex>& nodes = deferred_replicas_[*blk_id];
+            if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) nodes.push_back(node);
+            ++deferred;
+        }
+    }
+
+    static lockstats::Site site("BlockReport", "shard.mu");
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (by_shard[i].empty()) continue;
+        // Indexada, así que cargada o a punto de publicarse (espera a load_mu)
+        NamespaceShard* shard = LoadedShard(i);
+        if (shard == nullptr) return Status(grpc::StatusCode::INTERNAL, "Partición no disponible");
+        lockstats::TimedLock<std::mutex> lock(shard->mu, site);
+        const ShardVersion* cur = shard->version.load();
+        std::unordered_map<std::string, std::shared_ptr<FileMetadata>> updated;  // copias con réplicas nuevas
+        std::vector<std::string> records;
+
+        for (const Located& loc : by_shard[i]) {
+            const std::string& file_key = loc.ref.file_key;
+            const size_t b = loc.ref.index;
+            auto u = updated.find(file_key);
+            const FileMetadata* file_meta = (u != updated.end()) ? u->second.get() : cur->FindFile(file_key);
+            // Otro bloque con el mismo hash, o borrado entre la búsqueda y el lock
+            if (file_meta == nullptr || b >= file_meta->blocks.size() ||
+                !file_meta->HasBlockId(b, *loc.block_id)) {
+                continue;
+            }
+            ++matched;
+
+            // comprobar si ya existe el datanode en la lista
+            bool already = false;
+            for (NodeIndex existing : file_meta->blocks[b].replicas) {
+                if (existing == node) {
+                    already = true;
+                    break;
                 }
             }
-            if (found) break;
+            if (!already) {
+                if (u == updated.end()) u = updated.emplace(file_key, std::make_shared<FileMetadata>(*file_meta)).first;
+                u->second->blocks[b].replicas.push_back(node);
+                if (persist_locations_) records.push_back(EncodeAddBlockLocation(file_key, b, dn_info));
+                ++added;
+                LOG_DEBUG("[BlockReport] asociando block " << *loc.block_id << " -> datanode " << id);
+            }
         }
-        if (!found) {
-            std::cout << "[BlockReport] block " << blk_id << " no está en metadatos (ignorado)\n";
+        if (!updated.empty()) {
+            auto next = std::make_unique<ShardVersion>(*cur);
+            for (auto& kv : updated) next->PutFile(kv.first, std::move(kv.second));
+            PublishVersion(*shard, next.release());
+            for (const std::string& r : records) {
+                const uint64_t txid = edit_log_.Append(r);
+                if (txid == 0) lost = true;
+                last_txid = std::max(last_txid, txid);
+            }
         }
     }
+    LOG_INFO("[BlockReport] datanode " << id << " blocks=" << request->block_ids_size()
+             << " nuevas_replicas=" << added << " diferidos=" << deferred
+             << " desconocidos=" << (static_cast<size_t>(request->block_ids_size()) - matched - deferred));
 
-    if (changed) {
+    if (lost || last_txid > 0) {
         // >>> Persistencia solo si hubo cambios reales
-        (void)SaveSnapshotUnlocked();
+        const Status st = CommitMutation(lost ? 0 : last_txid);
+        if (!st.ok()) return st;
     }
 
     response->set_success(true);
@@ -730,11 +1038,26 @@ Status NameNodeServiceImpl::BlockReport(ServerContext* /*ctx*/,
 // MÉTODOS AUXILIARES
 // =============================================
 
-// helper: starts_with
-bool NameNodeServiceImpl::starts_with(const std::string& s, const std::string& prefix) const {
-    if (prefix.empty()) return true;
-    if (prefix.size() > s.size()) return false;
-    return std::equal(prefix.begin(), prefix.end(), s.begin());
+// Partición de un usuario: hash estable de user_id módulo número de particiones
+size_t NameNodeServiceImpl::ShardIndex(std::string_view user_id) const {
+    std::hash<std::string_view> hasher;  // mismo valor que std::hash<std::string>
+    return hasher(user_id) % shards_.size();
+}
+
+NamespaceShard* NameNodeServiceImpl::ShardFor(const std::string& user_id) {
+    return LoadedShard(ShardIndex(user_id));
+}
+
+void NameNodeServiceImpl::IndexBlocks(const ShardVersion& version) {
+    std::vector<BlockMap::FileRef> files;
+    files.reserve(version.files.size());
+    version.files.ForEach([&](const std::string& key, const FileMap::Value& fm) { files.emplace_back(&key, fm.get()); });
+    block_map_.AddFiles(files);
+}
+
+std::string NameNodeServiceImpl::UserIdFromKey(const std::string& key) {
+    auto c = key.find(':');
+    return (c == std::string::npos) ? key : key.substr(0, c);
 }
 
 // ================================
@@ -744,143 +1067,677 @@ std::string NameNodeServiceImpl::MetaPath(const std::string& file) const {
     return meta_dir_.empty() ? ("/var/lib/griddfs/meta/" + file) : (meta_dir_ + "/" + file);
 }
 
-// Formato de fsimage.txt (líneas con '\t'):
-// SEQ 1
-// USER  <user_id>\t<username>\t<password_hash>\t<created_ms>
-// DIR   <path>
-// FILE  <file_key>\t<owner_id>\t<size>\t<created_ms>\t<filename>
-// BLK   <file_key>\t<block_id>\t<idx>\t<size>
-// LOC   <block_id>\t<datanode_id>\t<address>
-bool NameNodeServiceImpl::SaveSnapshotUnlocked() {
-    std::ostringstream out;
-
-    out << "SEQ\t1\n";
-    // USERS
-    for (const auto& kv : users_) {
-        const auto& u = kv.second;
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      u.created_time.time_since_epoch()).count();
-        out << "USER\t" << u.user_id << "\t" << u.username << "\t"
-            << u.password_hash << "\t" << ms << "\n";
-    }
-
-    // DIRS
-    for (const auto& d : directories_) {
-        out << "DIR\t" << d << "\n";
-    }
-
-    // FILES + BLOCKS + LOCATIONS
-    for (const auto& kv : files_) {
-        const std::string& file_key = kv.first;       // user_id:filename
-        const FileMetadata& fm = kv.second;
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      fm.created_time.time_since_epoch()).count();
-        out << "FILE\t" << file_key << "\t" << fm.owner_id << "\t"
-            << fm.size << "\t" << ms << "\t" << fm.filename << "\n";
-
-        for (size_t idx = 0; idx < fm.blocks.size(); ++idx) {
-            const auto& b = fm.blocks[idx];
-            out << "BLK\t" << file_key << "\t" << b.block_id() << "\t"
-                << idx << "\t" << b.size() << "\n";
-            for (const auto& dn : b.datanodes()) {
-                out << "LOC\t" << b.block_id() << "\t" << dn.id()
-                    << "\t" << dn.address() << "\n";
-            }
+// Cada mutación publica su versión antes de añadir su registro, así que un
+// checkpoint que lee LastTxid() = T y después las versiones incluye todas
+// las mutaciones <= T (y quizá alguna posterior; el replay es idempotente).
+Status NameNodeServiceImpl::CommitMutation(uint64_t txid) {
+    if (txid == 0) {
+        // El log está detenido (ver EditLog): ninguna mutación es durable
+        return Status(grpc::StatusCode::INTERNAL, "Edit log no disponible");
+    }
+
+    // Disparo por registros o bytes sin cubrir (un solo aviso por checkpoint)
+    if (!checkpoint_requested_.load(std::memory_order_relaxed) && CheckpointDue(txid) != nullptr) {
+        if (!checkpoint_requested_.exchange(true)) {
+            std::lock_guard<std::mutex> lock(ckpt_mu_);
+            ckpt_cv_.notify_one();
         }
     }
 
-    // Escritura atómica a fsimage.txt
-    const std::string path = MetaPath("fsimage.txt");
+    if (durability_ != Durability::kSync) return Status::OK;
+
+    // Espera a que el registro esté en disco (latencia de durabilidad)
+    static lockstats::Site site("CommitMutation", "editlog.fsync");
+    const uint64_t t0 = lockstats::NowNs();
+    const bool synced = edit_log_.Sync(txid);
+    site.RecordWait(lockstats::NowNs() - t0);
+    if (!synced) return Status(grpc::StatusCode::INTERNAL, "No se pudo escribir el edit log");
+    return Status::OK;
+}
+
+// Qué umbral superó el log (nullptr si ninguno). El checkpointer puede haber
+// avanzado más allá de 'txid': las restas se protegen.
+const char* NameNodeServiceImpl::CheckpointDue(uint64_t txid) const {
+    const uint64_t ckpt_txid = checkpoint_txid_.load(std::memory_order_relaxed);
+    if (checkpoint_txns_ > 0 && txid > ckpt_txid && txid - ckpt_txid >= checkpoint_txns_) return "txns";
+    const uint64_t ckpt_bytes = checkpoint_log_bytes_.load(std::memory_order_relaxed);
+    const uint64_t bytes = edit_log_.AppendedBytes();
+    if (checkpoint_bytes_ > 0 && bytes > ckpt_bytes && bytes - ckpt_bytes >= checkpoint_bytes_) return "edits_bytes";
+    return nullptr;
+}
+
+void NameNodeServiceImpl::CheckpointLoop() {
+    using clock = std::chrono::steady_clock;
+    auto next_checkpoint = clock::now() + checkpoint_interval_;
+    bool backoff = false;  // el último falló: solo reintenta por tiempo
+    std::unique_lock<std::mutex> lock(ckpt_mu_);
+    for (;;) {
+        ckpt_cv_.wait_until(lock, next_checkpoint, [&] {
+            return stopping_ || (!backoff && checkpoint_requested_.load());
+        });
+        const bool stopping = stopping_;
+        lock.unlock();
+
+        // Se rearma antes de comprobar: un aviso posterior no se pierde
+        const bool requested = checkpoint_requested_.exchange(false);
+        const char* trigger = nullptr;
+        if (stopping) trigger = "shutdown";
+        else if (clock::now() >= next_checkpoint) trigger = "interval";
+        else if (requested && !backoff) trigger = CheckpointDue(edit_log_.LastTxid());
+        if (trigger != nullptr) {
+            backoff = !RunCheckpoint(trigger);
+            next_checkpoint = clock::now() + checkpoint_interval_;
+        }
+
+        lock.lock();
+        if (stopping) break;
+    }
+}
+
+// Rota el log y guarda un fsimage con txid = último registro del segmento
+// cerrado; así ese segmento (y los anteriores) quedan cubiertos y pueden
+// borrarse. Los handlers siguen atendiendo: el fsimage se construye desde
+// las versiones publicadas. Un fallo se registra; el log sigue intacto.
+bool NameNodeServiceImpl::RunCheckpoint(const char* trigger) {
+    if (edit_log_.LastTxid() == checkpoint_txid_.load() && !legacy_image_) return true;  // sin cambios
+    const auto t0 = std::chrono::steady_clock::now();
+    uint64_t txid = 0;
+    if (!edit_log_.Roll(&txid)) return false;
+    const uint64_t log_bytes = edit_log_.AppendedBytes();
+    if (!edit_log_.Sync(txid)) return false;
+    if (!SaveSnapshotUnlocked(txid)) return false;
+    checkpoint_txid_ = txid;
+    checkpoint_log_bytes_ = log_bytes;
+    legacy_image_ = false;
+    edit_log_.Purge(txid);
+
+    const auto elapsed = std::chrono::steady_clock::now() - t0;
+    last_ckpt_duration_us_ = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    last_ckpt_time_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    ++checkpoints_;
+
+    std::ostringstream stats;
+    stats << "[Checkpoint] trigger=" << trigger << " txid=" << txid
+          << " duration_ms=" << std::chrono::duration<double, std::milli>(elapsed).count() << "\n";
+    edit_log_.DumpStats(stats);
+    LOG_INFO(stats.str());
+    return true;
+}
+
+NameNodeServiceImpl::CheckpointInfo NameNodeServiceImpl::LastCheckpoint() const {
+    CheckpointInfo info;
+    info.txid = checkpoint_txid_.load();
+    info.duration_ms = last_ckpt_duration_us_.load() / 1000.0;
+    info.time_ms = last_ckpt_time_ms_.load();
+    info.count = checkpoints_.load();
+    return info;
+}
+
+void NameNodeServiceImpl::DumpStats(std::ostream& os) const {
+    lockstats::Dump(os);
+    edit_log_.DumpStats(os);
+    const CheckpointInfo ckpt = LastCheckpoint();
+    os << std::fixed << std::setprecision(1)
+       << "[Checkpoint] count=" << ckpt.count << " last_txid=" << ckpt.txid
+       << " last_duration_ms=" << ckpt.duration_ms << " last_time_ms=" << ckpt.time_ms
+       << "\n" << std::defaultfloat;
+}
+
+// Formato en fsimage.h. Se escribe siempre fsimage.img (binario); el
+// fsimage.txt de versiones anteriores solo se lee y se borra tras el
+// primer checkpoint binario.
+bool NameNodeServiceImpl::SaveSnapshotUnlocked(uint64_t txid) {
+    // Con carga diferida, antes se materializan las particiones que falten
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (LoadedShard(i) == nullptr) {
+            LOG_ERROR("[Checkpoint] partición " << i << " sin cargar; no se guarda la imagen");
+            return false;
+        }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const std::string path = MetaPath("fsimage.img");
     const std::string tmp  = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("[Checkpoint] no se pudo abrir " << tmp << ": " << std::strerror(errno));
+        return false;
+    }
+
+    // Se fijan las versiones publicadas (copias que comparten archivos y
+    // árbol con ellas) bajo un guard corto: mientras se codifica y se
+    // escribe, las versiones que retiran los escritores se siguen liberando
+    std::unique_ptr<const UserTable> users;
+    std::vector<std::unique_ptr<const ShardVersion>> pinned(shards_.size());
+    const auto t_pin = std::chrono::steady_clock::now();
     {
-        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
-        if (!ofs) return false;
-        const auto s = out.str();
-        ofs.write(s.data(), s.size());
-        ofs.flush();
-        int fd = ::open(tmp.c_str(), O_RDONLY);
-        if (fd >= 0) { ::fsync(fd); ::close(fd); }
-    }
-    ::rename(tmp.c_str(), path.c_str());
+        rcu::ReadGuard guard;
+        users = std::make_unique<const UserTable>(*users_.load());
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            pinned[i] = std::make_unique<const ShardVersion>(*shards_[i]->version.load());
+        }
+    }
+    static lockstats::Site site("SaveSnapshot", "rcu");
+    site.RecordHold(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_pin).count()));
+
+    fsimage::ImageView image;
+    image.txid = txid;
+    image.datanodes = &datanodes_;
+    image.users.reserve(users->by_id.size());
+    image.user_partitions.reserve(users->by_id.size());
+    for (const auto& kv : users->by_id) {
+        image.users.push_back(&kv.second);
+        image.user_partitions.push_back(static_cast<uint32_t>(ShardIndex(kv.first)));
+    }
+
+    // Una partición del fsimage por shard (al cargar se reparte según
+    // el número de shards de ese momento)
+    size_t nfiles = 0;
+    image.partitions.resize(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        const ShardVersion* v = pinned[i].get();
+        fsimage::ImageView::Partition& part = image.partitions[i];
+        v->tree.CollectDirectories(&part.directories);
+        part.files.reserve(v->files.size());
+        v->files.ForEach([&](const std::string& key, const FileMap::Value& fm) { part.files.push_back({&key, fm.get()}); });
+        nfiles += v->files.size();
+    }
+    const auto t_collect = std::chrono::steady_clock::now();
+
+    // Se codifica, comprime y escribe por particiones (a la caché de
+    // páginas); el fsync va después
+    fsimage::WriteOptions opts;
+    opts.threads = fsimage_threads_;
+    opts.zstd_level = fsimage_zstd_level_;
+    opts.locations = persist_locations_;
+    fsimage::WriteStats wstats;
+    std::string err;
+    bool ok = fsimage::WriteBinary(image, fd, opts, &wstats, &err);
+    const auto t1 = std::chrono::steady_clock::now();
+
+    // Escritura atómica a fsimage.img
+    if (ok && ::fsync(fd) != 0) {
+        err = std::string("fsync: ") + std::strerror(errno);
+        ok = false;
+    }
+    ::close(fd);
+    if (!ok) {
+        LOG_ERROR("[Checkpoint] error escribiendo " << tmp << ": " << err);
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    if (::rename(tmp.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("[Checkpoint] no se pudo renombrar " << tmp);
+        return false;
+    }
+    // El formato anterior ya no es la imagen vigente
+    if (::unlink(MetaPath("fsimage.txt").c_str()) == 0) {
+        LOG_INFO("[Checkpoint] fsimage.txt migrado a fsimage.img");
+    }
+    editlog::SyncDir(meta_dir_);  // el rename debe ser durable antes de purgar el log
+    const auto t2 = std::chrono::steady_clock::now();
+
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    LOG_INFO("[Checkpoint] txid=" << txid << " files=" << nfiles
+             << " bytes=" << wstats.file_bytes << " raw_bytes=" << wstats.raw_bytes
+             << " zstd_level=" << fsimage_zstd_level_
+             << " partitions=" << shards_.size() << " threads=" << fsimage_threads_
+             << " collect_ms=" << ms(t_collect - t0) << " encode_write_ms=" << ms(t1 - t_collect)
+             << " fsync_ms=" << ms(t2 - t1)
+             << " total_ms=" << ms(t2 - t0));
     return true;
 }
 
-static std::vector<std::string> SplitTabs(const std::string& line) {
-    std::vector<std::string> v;
-    std::string cur;
-    std::istringstream is(line);
-    while (std::getline(is, cur, '\t')) v.push_back(cur);
-    return v;
+using StagedFile = std::pair<std::string, std::shared_ptr<const FileMetadata>>;
+
+/**
+ * Construye una versión de partición con lo decodificado del fsimage
+ * (vacía los vectores). El mapa es nuevo, así que cada inserción modifica
+ * sus nodos en su sitio.
+ */
+static std::unique_ptr<ShardVersion> BuildShardVersion(const std::vector<std::vector<StagedFile>*>& files,
+                                                       const std::vector<std::vector<std::string>*>& dirs,
+                                                       size_t* nfiles) {
+    auto version = std::make_unique<ShardVersion>();
+    DirTree::Builder tree;
+    for (auto* v : files) {
+        for (auto& f : *v) {
+            tree.AddFile(f.first);
+            version->files.Put(std::move(f.first), std::move(f.second));
+        }
+        std::vector<StagedFile>().swap(*v);
+    }
+    for (auto* v : dirs) {
+        for (const auto& d : *v) tree.AddDirectory(d);
+        std::vector<std::string>().swap(*v);
+    }
+    *nfiles = version->files.size();
+    version->tree = tree.Finish();
+    return version;
 }
 
 bool NameNodeServiceImpl::LoadSnapshotUnlocked() {
-    const std::string path = MetaPath("fsimage.txt");
-    std::ifstream ifs(path);
-    if (!ifs) return false; // primera vez
-
-    users_.clear(); users_by_id_.clear();
-    files_.clear(); directories_.clear(); directories_.insert("/");
-
-    // Para mapear block_id -> BlockInfo*
-    std::unordered_map<std::string, griddfs::BlockInfo*> blk_index;
-    // Para asegurar que FILE aparezca antes que BLK del mismo file_key
-    std::unordered_map<std::string, FileMetadata*> file_index;
-
-    std::string line;
-    while (std::getline(ifs, line)) {
-        if (line.empty()) continue;
-        auto t = SplitTabs(line);
-        if (t.empty()) continue;
-
-        if (t[0] == "USER" && t.size() >= 5) {
-            UserInfo u;
-            u.user_id = t[1];
-            u.username = t[2];
-            u.password_hash = t[3];
-            int64_t ms = std::stoll(t[4]);
-            u.created_time = std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
-            users_[u.username] = u;
-            users_by_id_[u.user_id] = u;
-        } else if (t[0] == "DIR" && t.size() >= 2) {
-            directories_.insert(t[1]);
-        } else if (t[0] == "FILE" && t.size() >= 6) {
-            std::string file_key = t[1];
-            FileMetadata fm;
-            fm.owner_id = t[2];
-            fm.size = static_cast<int64_t>(std::stoll(t[3]));
-            int64_t ms = std::stoll(t[4]);
-            fm.created_time = std::chrono::system_clock::time_point(std::chrono::milliseconds(ms));
-            fm.filename = t[5]; // nombre “visible”
-            files_[file_key] = fm;
-            file_index[file_key] = &files_[file_key];
-        } else if (t[0] == "BLK" && t.size() >= 5) {
-            std::string file_key = t[1];
-            std::string blk_id   = t[2];
-            int idx = std::stoi(t[3]);
-            int64_t sz = std::stoll(t[4]);
-            auto it = file_index.find(file_key);
-            if (it != file_index.end()) {
-                griddfs::BlockInfo bi;
-                bi.set_block_id(blk_id);
-                bi.set_size(sz);
-                it->second->blocks.push_back(bi);
-                blk_index[blk_id] = &it->second->blocks.back();
-            }
-        } else if (t[0] == "LOC" && t.size() >= 4) {
-            std::string blk_id = t[1];
-            std::string dn_id  = t[2];
-            std::string addr   = t[3];
-            auto it = blk_index.find(blk_id);
-            if (it != blk_index.end()) {
-                auto* dni = it->second->add_datanodes();
-                dni->set_id(dn_id);
-                dni->set_address(addr);
+    // Fase 1 (decode): cada partición del fsimage, en su hilo, deja sus
+    // entradas agrupadas por shard de destino. Fase 2 (merge): cada shard,
+    // en su hilo, junta lo de todas las particiones en un mapa nuevo.
+    // Fase 3 (publish): se publican las versiones.
+    if (lazy_load_) {
+        bool loaded = false;
+        if (!LoadLazyUnlocked(&loaded)) return false;
+        if (loaded) return true;
+    }
+    struct StagedPartition {
+        std::vector<std::vector<std::string>> dirs;   // [shard]
+        std::vector<std::vector<StagedFile>> files;   // [shard]
+    };
+    struct Staging : fsimage::ImageSink {
+        const NameNodeServiceImpl* self;
+        std::unique_ptr<UserTable> users = std::make_unique<UserTable>();
+        std::vector<StagedPartition> parts;
+
+        size_t ShardOf(const std::string& key) const {
+            const size_t c = key.find(':');
+            return self->ShardIndex(std::string_view(key).substr(0, c));
+        }
+        void OnUser(UserInfo&& u) override {
+            users->by_id[u.user_id] = u;
+            users->by_name[u.username] = std::move(u);
+        }
+        void OnPartitions(uint32_t count) override {
+            parts.resize(count);
+            for (auto& p : parts) {
+                p.dirs.resize(self->shards_.size());
+                p.files.resize(self->shards_.size());
             }
         }
+        void OnDirectory(uint32_t part, std::string&& dir_key) override {
+            // Las entradas sin "user_id:" (el antiguo "/" global) no pertenecen a nadie
+            if (dir_key.find(':') == std::string::npos) return;
+            auto& v = parts[part].dirs[ShardOf(dir_key)];
+            v.push_back(std::move(dir_key));
+        }
+        void OnFile(uint32_t part, std::string&& file_key, FileMetadata&& fm) override {
+            auto& v = parts[part].files[ShardOf(file_key)];
+            v.emplace_back(std::move(file_key), std::make_shared<const FileMetadata>(std::move(fm)));
+        }
+        bool WantLocations() const override { return self->persist_locations_; }
+        DataNodeNames* DataNodes() override { return datanodes; }
+        DataNodeRegistry* datanodes;
+    } sink;
+    sink.self = this;
+    sink.datanodes = &datanodes_;
+
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    std::string err;
+    uint64_t txid = 0;
+    std::string path = MetaPath("fsimage.img");
+    fsimage::MappedFile image;
+    clock::time_point t_map;
+    if (image.Open(path, &err)) {
+        t_map = clock::now();
+        if (!fsimage::DecodeBinary(image.data(), image.size(), sink, fsimage_threads_, &txid, &err)) {
+            LOG_ERROR("[Load] " << path << ": " << err);
+            return false;
+        }
+    } else {
+        if (!err.empty()) {
+            LOG_ERROR("[Load] " << err);
+            return false;
+        }
+        path = MetaPath("fsimage.txt");  // formato anterior
+        if (!image.Open(path, &err)) {
+            if (!err.empty()) LOG_ERROR("[Load] " << err);
+            return err.empty();  // sin imagen: primera vez
+        }
+        t_map = clock::now();
+        if (!fsimage::DecodeText(image.data(), image.size(), sink, &txid, &err)) {
+            LOG_ERROR("[Load] " << path << ": " << err);
+            return false;
+        }
+        legacy_image_ = true;  // el próximo checkpoint lo reescribe en binario
+    }
+    const auto t_decode = clock::now();
+
+    // Merge: un mapa nuevo por shard
+    std::vector<std::unique_ptr<ShardVersion>> versions(shards_.size());
+    std::vector<size_t> shard_files(shards_.size(), 0);
+    fsimage::ParallelFor(shards_.size(), fsimage_threads_, [&](size_t i) {
+        std::vector<std::vector<StagedFile>*> files;
+        std::vector<std::vector<std::string>*> dirs;
+        for (auto& part : sink.parts) {
+            files.push_back(&part.files[i]);
+            dirs.push_back(&part.dirs[i]);
+        }
+        versions[i] = BuildShardVersion(files, dirs, &shard_files[i]);
+    });
+    const auto t_merge = clock::now();
+
+    // Publicar (el constructor aún no atiende RPCs: no hay lectores)
+    size_t nfiles = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        delete shards_[i]->version.exchange(versions[i].release());
+        nfiles += shard_files[i];
+    }
+    delete users_.exchange(sink.users.release());
+    checkpoint_txid_ = txid;
+    const auto t_publish = clock::now();
+
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    LOG_INFO("[Load] " << path << " txid=" << txid << " files=" << nfiles
+             << " partitions=" << sink.parts.size() << " threads=" << fsimage_threads_
+             << " map_ms=" << ms(t_map - t0) << " decode_ms=" << ms(t_decode - t_map)
+             << " merge_ms=" << ms(t_merge - t_decode) << " publish_ms=" << ms(t_publish - t_merge)
+             << " load_ms=" << ms(t_publish - t0));
+    return true;
+}
+
+bool NameNodeServiceImpl::LoadLazyUnlocked(bool* loaded) {
+    *loaded = false;
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    const std::string path = MetaPath("fsimage.img");
+    auto lazy = std::make_unique<LazyImage>();
+    std::string err;
+    if (!lazy->file.Open(path, &err)) {
+        if (err.empty()) return true;  // sin imagen binaria: la carga normal decide
+        LOG_ERROR("[Load] " << err);
+        return false;
+    }
+
+    // Solo usuarios; el CRC de todo se comprueba ya para no descubrir una
+    // imagen dañada con el servidor atendiendo
+    struct UserSink : fsimage::ImageSink {
+        std::unique_ptr<UserTable> users = std::make_unique<UserTable>();
+        std::vector<std::string> order;
+        void OnUser(UserInfo&& u) override {
+            order.push_back(u.user_id);
+            users->by_id[u.user_id] = u;
+            users->by_name[u.username] = std::move(u);
+        }
+        void OnPartitions(uint32_t) override {}
+        void OnDirectory(uint32_t, std::string&&) override {}
+        void OnFile(uint32_t, std::string&&, FileMetadata&&) override {}
+    } sink;
+    fsimage::ImageReader& reader = lazy->reader;
+    if (!reader.Open(lazy->file.data(), lazy->file.size(), &err) ||
+        !reader.Verify(fsimage_threads_, &err) || !reader.ReadUsers(sink, &err)) {
+        LOG_ERROR("[Load] " << path << ": " << err);
+        return false;
+    }
+
+    // Cada usuario debe estar en la partición que le toca en este proceso
+    const std::vector<uint32_t>& parts = reader.UserPartitions();
+    bool same = reader.partitions() == shards_.size() && parts.size() == sink.order.size();
+    for (size_t k = 0; same && k < parts.size(); ++k) same = parts[k] == ShardIndex(sink.order[k]);
+    if (!same) {
+        LOG_WARN("[Load] " << path << " no admite carga diferida (partitions=" << reader.partitions()
+                 << " shards=" << shards_.size() << "); se carga entero");
+        return true;
+    }
+
+    delete users_.exchange(sink.users.release());
+    checkpoint_txid_ = reader.txid();
+    lazy->pending.resize(shards_.size());
+    for (auto& shard : shards_) shard->loaded = false;
+    unloaded_shards_ = shards_.size();
+    lazy_ = std::move(lazy);
+    *loaded = true;
+
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    LOG_INFO("[Load] " << path << " txid=" << checkpoint_txid_.load() << " diferida: users=" << sink.order.size()
+             << " partitions=" << shards_.size() << " open_ms=" << ms(clock::now() - t0));
+    return true;
+}
+
+NamespaceShard* NameNodeServiceImpl::LoadedShard(size_t i) {
+    NamespaceShard& shard = *shards_[i];
+    if (!shard.loaded.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(shard.load_mu);
+        if (!shard.loaded.load(std::memory_order_acquire) && !MaterializeShard(i)) return nullptr;
+    }
+    return &shard;
+}
+
+bool NameNodeServiceImpl::MaterializeShard(size_t i) {
+    const auto t0 = std::chrono::steady_clock::now();
+    struct PartitionSink : fsimage::ImageSink {
+        const NameNodeServiceImpl* self;
+        std::vector<StagedFile> files;
+        std::vector<std::string> dirs;
+        void OnUser(UserInfo&&) override {}
+        void OnPartitions(uint32_t) override {}
+        void OnDirectory(uint32_t, std::string&& dir_key) override {
+            if (dir_key.find(':') != std::string::npos) dirs.push_back(std::move(dir_key));
+        }
+        void OnFile(uint32_t, std::string&& file_key, FileMetadata&& fm) override {
+            files.emplace_back(std::move(file_key), std::make_shared<const FileMetadata>(std::move(fm)));
+        }
+        bool WantLocations() const override { return self->persist_locations_; }
+        DataNodeNames* DataNodes() override { return datanodes; }
+        DataNodeRegistry* datanodes;
+    } sink;
+    sink.self = this;
+    sink.datanodes = &datanodes_;
+    std::string err;
+    if (!lazy_->reader.ReadPartition(static_cast<uint32_t>(i), sink, &err)) {
+        // Los CRC se comprobaron al arrancar, así que es un error de lectura:
+        // la partición sigue sin cargar y el siguiente uso lo reintenta
+        LOG_ERROR("[Load] partición " << i << ": " << err);
+        return false;
+    }
+    size_t nfiles = 0;
+    std::vector<std::unique_ptr<ShardVersion>> versions(shards_.size());
+    versions[i] = BuildShardVersion({&sink.files}, {&sink.dirs}, &nfiles);
+
+    // Registros posteriores a la imagen; todos son de esta partición y
+    // ninguno de usuarios (esos se aplicaron al arrancar)
+    std::vector<std::string> pending = std::move(lazy_->pending[i]);
+    UserTable no_users;
+    for (const std::string& payload : pending) {
+        if (!ApplyEdit(payload, no_users, versions)) LOG_WARN("[EditLog] registro no reconocido (ignorado)");
+    }
+
+    IndexBlocks(*versions[i]);
+
+    NamespaceShard& shard = *shards_[i];
+    size_t replicas = 0;
+    size_t unknown = 0;
+    size_t lost = 0;  // registros de réplicas que no entraron en el log
+    {
+        // Indexada antes de tomar deferred_mu_: un BlockReport posterior ya la
+        // encuentra en el índice, y lo que dejó antes está en deferred_replicas_
+        std::lock_guard<std::mutex> dlock(deferred_mu_);
+        ShardVersion& v = *versions[i];
+        std::vector<std::pair<std::string, std::shared_ptr<FileMetadata>>> updated;
+        std::vector<std::string> records;
+        if (!deferred_replicas_.empty()) {
+            std::string block_id, dn_id, dn_addr;
+            v.files.ForEach([&](const std::string& key, const FileMap::Value& value) {
+                const FileMetadata& fm = *value;
+                std::shared_ptr<FileMetadata> copy;
+                for (size_t b = 0; b < fm.blocks.size(); ++b) {
+                    fm.BlockId(b, &block_id);
+                    auto it = deferred_replicas_.find(block_id);
+                    if (it == deferred_replicas_.end()) continue;
+                    for (NodeIndex node : it->second) {
+                        const std::vector<NodeIndex>& reps = (copy ? *copy : fm).blocks[b].replicas;
+                        if (std::find(reps.begin(), reps.end(), node) != reps.end()) continue;
+                        if (!copy) copy = std::make_shared<FileMetadata>(fm);
+                        copy->blocks[b].replicas.push_back(node);
+                        if (persist_locations_) {
+                            griddfs::DataNodeInfo dn;
+                            datanodes_.Lookup(node, &dn_id, &dn_addr);
+                            dn.set_id(dn_id);
+                            dn.set_address(dn_addr);
+                            records.push_back(EncodeAddBlockLocation(key, b, dn));
+                        }
+                        ++replicas;
+                    }
+                    deferred_replicas_.erase(it);
+                }
+                if (copy) updated.emplace_back(key, std::move(copy));
+            });
+        }
+        for (auto& u : updated) v.PutFile(u.first, std::move(u.second));
+
+        std::lock_guard<std::mutex> lock(shard.mu);
+        PublishVersion(shard, versions[i].release());
+        // Sin Sync: las réplicas se vuelven a reportar tras un reinicio. Si
+        // el log está detenido (Append devuelve 0) quedan solo en memoria
+        for (const std::string& r : records) {
+            if (edit_log_.Append(r) == 0) ++lost;
+        }
+        shard.loaded.store(true, std::memory_order_release);
+        if (--unloaded_shards_ == 0) {
+            unknown = deferred_replicas_.size();
+            deferred_replicas_.clear();
+        }
+    }
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    LOG_INFO("[Load] partición " << i << " cargada files=" << nfiles << " edits=" << pending.size()
+             << " replicas_diferidas=" << replicas << " ms=" << ms(std::chrono::steady_clock::now() - t0));
+    if (unknown > 0) LOG_INFO("[BlockReport] " << unknown << " bloques reportados no están en metadatos (ignorados)");
+    if (lost > 0) {
+        LOG_ERROR("[Load] partición " << i << ": " << lost
+                  << " réplicas diferidas sin registro en el edit log (no disponible); solo en memoria");
+    }
+    return true;
+}
+
+void NameNodeServiceImpl::WarmupLoop() {
+    const auto t0 = std::chrono::steady_clock::now();
+    size_t failed = 0;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (warmup_stop_) return;
+        if (LoadedShard(i) == nullptr) ++failed;
+    }
+    if (failed > 0) {
+        // La imagen sigue abierta para reintentarlas cuando se usen
+        LOG_ERROR("[Load] " << failed << " particiones sin cargar tras el warmup");
+        return;
     }
+    // Todas cargadas: nadie vuelve a leer la imagen
+    lazy_.reset();
+    auto ms = [](auto d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    LOG_INFO("[Load] carga diferida completa warmup_ms=" << ms(std::chrono::steady_clock::now() - t0));
+}
+
+bool NameNodeServiceImpl::ReplayEditLogUnlocked(uint64_t after_txid, uint64_t* last_txid) {
+    // Copias de trabajo: se publican al final (aún no hay lectores)
+    UserTable users = *users_.load();
+    std::vector<std::unique_ptr<ShardVersion>> versions;
+    versions.reserve(shards_.size());
+    for (const auto& shard : shards_) versions.push_back(std::make_unique<ShardVersion>(*shard->version.load()));
+
+    size_t bad = 0;
+    std::string key;
+    uint64_t last = after_txid;
+    const bool ok = EditLog::Replay(meta_dir_, after_txid, [&](uint64_t txid, const std::string& payload) {
+        // Carga diferida: se aplica cuando se cargue su partición
+        if (lazy_ && EditKey(payload, &key)) {
+            lazy_->pending[ShardIndex(UserIdFromKey(key))].push_back(payload);
+            return;
+        }
+        if (!ApplyEdit(payload, users, versions)) {
+            ++bad;
+            LOG_WARN("[EditLog] registro txid=" << txid << " no reconocido (ignorado)");
+        }
+    }, &last);
+    if (!ok) return false;
+    *last_txid = last;
+    if (last == after_txid) return true;
+
+    for (size_t i = 0; i < shards_.size(); ++i) delete shards_[i]->version.exchange(versions[i].release());
+    delete users_.exchange(new UserTable(std::move(users)));
+    if (bad > 0) LOG_WARN("[EditLog] " << bad << " registros ignorados");
     return true;
 }
 
+bool NameNodeServiceImpl::ApplyEdit(const std::string& payload, UserTable& users,
+                                    std::vector<std::unique_ptr<ShardVersion>>& versions) {
+    coding::Decoder d(payload);
+    uint8_t op;
+    if (!d.GetU8(&op)) return false;
+    auto version_for = [&](const std::string& key) -> ShardVersion& {
+        return *versions[ShardIndex(UserIdFromKey(key))];
+    };
+
+    switch (static_cast<EditOp>(op)) {
+    case EditOp::kRegisterUser: {
+        UserInfo u;
+        int64_t ms;
+        if (!d.GetString(&u.user_id) || !d.GetString(&u.username) ||
+            !d.GetString(&u.password_hash) || !d.GetSigned(&ms)) return false;
+        u.created_time = FromMillis(ms);
+        users.by_name[u.username] = u;
+        users.by_id[u.user_id] = u;
+        return true;
+    }
+    case EditOp::kCreateFile: {
+        std::string file_key;
+        FileMetadata fm;
+        int64_t ms;
+        uint64_t nblocks;
+        std::string owner_id, filename;
+        if (!d.GetString(&file_key) || !d.GetString(&owner_id) || !d.GetSigned(&fm.size) ||
+            !d.GetSigned(&ms) || !d.GetString(&filename) || !d.GetVarint(&nblocks)) return false;
+        fm.SetOwner(owner_id);
+        fm.SetFilename(filename);
+        fm.created_time = FromMillis(ms);
+        for (uint64_t i = 0; i < nblocks; ++i) {
+            std::string blk_id;
+            int64_t sz;
+            uint64_t nlocs;
+            if (!d.GetString(&blk_id) || !d.GetSigned(&sz) || !d.GetVarint(&nlocs)) return false;
+            fm.blocks.emplace_back();
+            fm.SetBlockId(i, blk_id);
+            fm.blocks[i].size = sz;
+            for (uint64_t j = 0; j < nlocs; ++j) {
+                std::string dn_id, addr;
+                if (!d.GetString(&dn_id) || !d.GetString(&addr)) return false;
+                if (!persist_locations_) continue;  // llegarán con los BlockReport
+                fm.blocks[i].replicas.push_back(datanodes_.IndexOf(dn_id, addr));
+            }
+        }
+        version_for(file_key).PutFile(file_key, std::make_shared<const FileMetadata>(std::move(fm)));
+        return true;
+    }
+    case EditOp::kDeleteFile:
+    case EditOp::kCreateDirectory:
+    case EditOp::kRemoveDirectory: {
+        std::string key;
+        if (!d.GetString(&key)) return false;
+        ShardVersion& v = version_for(key);
+        if (op == static_cast<uint8_t>(EditOp::kDeleteFile)) v.EraseFile(key);
+        else if (op == static_cast<uint8_t>(EditOp::kCreateDirectory)) v.PutDirectory(key);
+        else v.EraseDirectory(key);
+        return true;
+    }
+    case EditOp::kAddBlockLocation: {
+        std::string file_key, dn_id, addr;
+        uint64_t idx;
+        if (!d.GetString(&file_key) || !d.GetVarint(&idx) ||
+            !d.GetString(&dn_id) || !d.GetString(&addr)) return false;
+        if (!persist_locations_) return true;
+        ShardVersion& v = version_for(file_key);
+        const FileMetadata* cur = v.FindFile(file_key);
+        if (cur == nullptr || idx >= cur->blocks.size()) return true;  // borrado después
+        const NodeIndex node = datanodes_.IndexOf(dn_id, addr);
+        for (NodeIndex r : cur->blocks[idx].replicas) {
+            if (r == node) return true;
+        }
+        auto updated = std::make_shared<FileMetadata>(*cur);
+        updated->blocks[idx].replicas.push_back(node);
+        v.PutFile(file_key, std::move(updated));
+        return true;
+    }
+    }
+    return false;
+}
+
 // ================================
 // Utilidades de red (ctx->peer())
 // ================================
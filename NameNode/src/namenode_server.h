@@ -3,34 +3,67 @@
 
 #include <grpcpp/grpcpp.h>
 #include "griddfs.grpc.pb.h"
+#include "block_map.h"
+#include "datanode_registry.h"
+#include "dir_tree.h"
+#include "edit_log.h"
+#include "file_map.h"
+#include "metadata.h"
+#include "rcu.h"
 
+#include <atomic>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
-#include <set>
+#include <memory>
 #include <chrono>
+#include <condition_variable>
+#include <thread>
 #include <cstdint>
 
 // ==============================
-// Estructuras de metadatos
+// Espacio de nombres en memoria
 // ==============================
 
-// Información de usuario
-struct UserInfo {
-    std::string user_id;
-    std::string username;
-    std::string password_hash;
-    std::chrono::system_clock::time_point created_time;
+// Versión inmutable de una partición del espacio de nombres. Los archivos
+// están en un mapa persistente (file_map.h): una escritura copia solo el
+// camino hasta su clave y comparte el resto con la versión anterior.
+// 'tree' guarda los directorios y los hijos de cada uno (dir_tree.h).
+struct ShardVersion {
+    FileMap files;  // user_id:filename
+    DirTree tree;
+
+    const FileMetadata* FindFile(const std::string& file_key) const { return files.Find(file_key); }
+
+    // Solo sobre copias aún no publicadas (actualizan 'files' y 'tree');
+    // varias escrituras sobre la misma copia copian cada nodo una sola vez
+    void PutFile(const std::string& file_key, std::shared_ptr<const FileMetadata> fm);
+    void EraseFile(const std::string& file_key);
+    void PutDirectory(const std::string& dir_key);
+    void EraseDirectory(const std::string& dir_key);
+};
+
+// Partición del espacio de nombres. Cada usuario cae siempre en la misma
+// partición (hash de user_id), así que escrituras de usuarios distintos no
+// compiten por el mismo lock. Los lectores no toman mu: cargan 'version'
+// bajo un rcu::ReadGuard.
+struct NamespaceShard {
+    std::mutex mu;                                      // serializa escritores
+    std::atomic<const ShardVersion*> version{nullptr};
+    rcu::RetireList retired;                            // versiones retiradas (mu)
+
+    // Carga diferida: false hasta decodificar su partición del fsimage
+    // (ver NameNodeServiceImpl::LoadedShard); 'version' no es válida antes
+    std::atomic<bool> loaded{true};
+    std::mutex load_mu;  // serializa la carga; si falla, el siguiente uso la reintenta
 };
 
-// Metadata de archivo con propietario y bloques
-struct FileMetadata {
-    std::string filename;
-    std::string owner_id;
-    int64_t size;
-    std::chrono::system_clock::time_point created_time;
-    std::vector<griddfs::BlockInfo> blocks;
+// Tabla de usuarios inmutable; RegisterUser publica una copia ampliada
+struct UserTable {
+    std::unordered_map<std::string, UserInfo> by_name;  // username -> UserInfo
+    std::unordered_map<std::string, UserInfo> by_id;    // user_id -> UserInfo
 };
 
 // ==============================
@@ -39,7 +72,7 @@ struct FileMetadata {
 class NameNodeServiceImpl final : public griddfs::NameNodeService::Service {
 public:
     NameNodeServiceImpl();
-    ~NameNodeServiceImpl() override = default;
+    ~NameNodeServiceImpl() override;
 
     // --------- Autenticación ---------
     grpc::Status LoginUser(grpc::ServerContext* context,
@@ -88,18 +121,37 @@ public:
                              const griddfs::BlockReportRequest* request,
                              griddfs::BlockReportResponse* response) override;
 
+    // --------- Persistencia ---------
+    struct CheckpointInfo {
+        uint64_t txid = 0;          // último txid cubierto por fsimage.img
+        double duration_ms = 0;     // duración del último checkpoint
+        int64_t time_ms = 0;        // cuándo terminó (epoch ms; 0 = ninguno desde el arranque)
+        uint64_t count = 0;         // checkpoints completados desde el arranque
+    };
+    CheckpointInfo LastCheckpoint() const;
+
+    // Informe de estadísticas: lockstats, lotes del edit log y último
+    // checkpoint. Se vuelca cada GRIDDFS_LOCK_STATS_INTERVAL_S y al apagar.
+    void DumpStats(std::ostream& os) const;
+
 private:
-    // Sincronización
+    // Sincronización: mu_ serializa a quien publica una nueva tabla de
+    // usuarios. Usuarios y particiones se leen sin locks (versiones
+    // inmutables + rcu::ReadGuard); los DataNodes tienen su propio registro.
+    // Orden de locks: mu_ antes que cualquier shard, shards en orden de índice.
     std::mutex mu_;
 
-    // Usuarios y ficheros
-    std::unordered_map<std::string, UserInfo> users_;       // username -> UserInfo
-    std::unordered_map<std::string, UserInfo> users_by_id_; // user_id -> UserInfo
-    std::unordered_map<std::string, FileMetadata> files_;   // user_id:filename -> FileMetadata
+    // Usuarios (versión publicada; leer bajo rcu::ReadGuard)
+    std::atomic<const UserTable*> users_{nullptr};
+    rcu::RetireList users_retired_;  // (mu_)
 
-    // DataNodes registrados e índice de directorios
-    std::unordered_map<std::string, griddfs::DataNodeInfo> datanodes_;
-    std::set<std::string> directories_;
+    // Espacio de nombres particionado por user_id (GRIDDFS_NAMESPACE_SHARDS)
+    std::vector<std::unique_ptr<NamespaceShard>> shards_;
+    static constexpr size_t DEFAULT_NAMESPACE_SHARDS = 16;
+
+    // DataNodes registrados (no usa mu_: los heartbeats nunca esperan al
+    // espacio de nombres)
+    DataNodeRegistry datanodes_;
 
     // Tamaño por bloque (64 MiB)
     static constexpr int64_t DEFAULT_BLOCK_SIZE = 64LL * 1024LL * 1024LL;
@@ -110,17 +162,124 @@ private:
     bool verifyPassword(const std::string& password, const std::string& hash);
     bool userExists(const std::string& username);
     bool isFileOwner(const std::string& filename, const std::string& user_id);
-    bool isValidUser(const std::string& user_id);
+    bool isValidUser(const std::string& user_id);  // sin locks (RCU)
+
+    // --------- Particiones del espacio de nombres ---------
+    size_t ShardIndex(std::string_view user_id) const;
+    NamespaceShard* ShardFor(const std::string& user_id);  // ya cargada (LoadedShard); nullptr si falló
+    static std::string UserIdFromKey(const std::string& key);  // "user_id:..." -> user_id
 
-    // Utilidad
-    bool starts_with(const std::string& s, const std::string& prefix) const;
+    // Publica 'next' y retira la versión anterior (requiere shard.mu)
+    static void PublishVersion(NamespaceShard& shard, const ShardVersion* next);
 
-    // --------- Persistencia (snapshot plano) ---------
+    // block_id -> archivo (block_map.h). CreateFile/DeleteFile lo actualizan
+    // bajo el shard.mu del archivo; al arrancar se indexa cada partición
+    // cuando queda cargada (IndexBlocks)
+    BlockMap block_map_;
+    void IndexBlocks(const ShardVersion& version);
+
+    // --------- Persistencia (fsimage + edit log) ---------
     std::string meta_dir_;  // tomado de GRIDDFS_META_DIR o /var/lib/griddfs/meta
 
-    // Requieren que el caller haya tomado mu_
-    bool SaveSnapshotUnlocked();
+    // Save: solo desde el hilo checkpointer (o al apagar); guarda las
+    // versiones publicadas en fsimage.img y registra 'txid' como último cubierto.
+    // Load: sin concurrencia (constructor); lee fsimage.img (o el fsimage.txt
+    // anterior) y deja el txid en checkpoint_txid_. false si la imagen existe
+    // pero no se puede leer.
+    // Ambas reparten el trabajo por particiones en fsimage_threads_ hilos
+    // (GRIDDFS_FSIMAGE_THREADS, defecto: nº de CPUs). Save comprime con zstd
+    // (GRIDDFS_FSIMAGE_ZSTD_LEVEL, 0 = sin comprimir) y escribe por partes.
+    bool SaveSnapshotUnlocked(uint64_t txid);
     bool LoadSnapshotUnlocked();
+    unsigned fsimage_threads_ = 1;
+    int fsimage_zstd_level_ = 3;
+
+    // --------- Carga diferida (GRIDDFS_LAZY_LOAD=1) ---------
+    // Al arrancar solo se leen la cabecera, USERS y USER_PARTS de
+    // fsimage.img (y se comprueban los CRC); cada partición se decodifica
+    // la primera vez que se usa y warmup_ carga el resto en segundo plano.
+    // Los registros del edit log de una partición aún sin cargar esperan
+    // en LazyImage::pending. Requiere que la imagen tenga las mismas
+    // particiones que este proceso; si no, se carga entera.
+    struct LazyImage;
+    bool lazy_load_ = false;
+    std::unique_ptr<LazyImage> lazy_;     // se libera al terminar warmup_
+    std::thread warmup_;
+    std::atomic<bool> warmup_stop_{false};
+    bool LoadLazyUnlocked(bool* loaded);  // *loaded = false: no aplica
+    NamespaceShard* LoadedShard(size_t i);  // nullptr si no se pudo leer su partición
+    bool MaterializeShard(size_t i);        // con load_mu
+    void WarmupLoop();
+
+    // BlockReport no carga particiones: el índice de bloques solo cubre las
+    // cargadas, y las réplicas de bloques que no aparecen esperan aquí
+    // mientras quede alguna sin cargar. MaterializeShard aplica las de su
+    // partición antes de publicarla; al cargarse la última, lo que queda
+    // son bloques desconocidos y se descarta. Orden: deferred_mu_ antes
+    // que shard.mu.
+    std::mutex deferred_mu_;
+    std::unordered_map<std::string, std::vector<NodeIndex>> deferred_replicas_;  // block_id -> nodos (deferred_mu_)
+    std::atomic<size_t> unloaded_shards_{0};  // se decrementa con deferred_mu_
+
+    // Cada mutación publicada añade un registro al edit log (edit_log.h)
+    // sin soltar el lock que la serializa, así el orden del log coincide con
+    // el de publicación. Al arrancar se cargan fsimage.txt y los registros
+    // posteriores a su txid. Durabilidad:
+    //   sync  (defecto): la RPC responde cuando el lote con su registro está
+    //                    en disco (group commit, un fdatasync por lote).
+    //   async: la RPC responde enseguida; el escritor sincroniza a lo sumo
+    //          cada GRIDDFS_EDITLOG_FLUSH_MS.
+    enum class Durability { kSync, kAsync };
+    Durability durability_ = Durability::kSync;
+
+    // Réplicas de cada bloque (GRIDDFS_BLOCK_LOCATIONS):
+    //   persist (defecto): se guardan en el fsimage y en el edit log.
+    //   report: solo se guarda qué bloques tiene cada archivo; al arrancar
+    //           los bloques no tienen réplicas hasta que llega el BlockReport
+    //           de cada DataNode (las direcciones nunca quedan obsoletas).
+    bool persist_locations_ = true;
+    EditLog edit_log_;
+    EditLog::Options editlog_opts_;
+
+    // Aplica el edit log sobre copias aún no publicadas (solo al arrancar);
+    // false si está dañado
+    bool ReplayEditLogUnlocked(uint64_t after_txid, uint64_t* last_txid);
+    bool ApplyEdit(const std::string& payload, UserTable& users,
+                   std::vector<std::unique_ptr<ShardVersion>>& versions);
+
+    // --------- Checkpointer en segundo plano ---------
+    // Rota el edit log, escribe fsimage.img sin bloquear a los handlers y
+    // borra los segmentos que quedaron cubiertos. Se dispara al cumplirse
+    // lo primero de:
+    //   - GRIDDFS_CHECKPOINT_INTERVAL_MS desde el anterior (si hubo cambios)
+    //   - GRIDDFS_CHECKPOINT_TXNS registros sin cubrir
+    //   - GRIDDFS_CHECKPOINT_EDITS_BYTES escritos en el log desde el anterior
+    // y al apagar. Los dos últimos los comprueba CommitMutation; tras un
+    // fallo se ignoran hasta el siguiente checkpoint por tiempo.
+    std::chrono::milliseconds checkpoint_interval_{60000};
+    uint64_t checkpoint_txns_ = 1000000;              // 0 = sin disparo por registros
+    uint64_t checkpoint_bytes_ = 256ull << 20;        // 0 = sin disparo por tamaño
+    std::atomic<uint64_t> checkpoint_txid_{0};        // txid del último fsimage (escribe el checkpointer)
+    std::atomic<uint64_t> checkpoint_log_bytes_{0};   // AppendedBytes() al rotar en el último
+    std::atomic<bool> checkpoint_requested_{false};
+    bool legacy_image_ = false;           // se cargó fsimage.txt: migrar aunque no haya cambios
+    std::mutex ckpt_mu_;
+    std::condition_variable ckpt_cv_;     // despierta al checkpointer
+    bool stopping_ = false;               // (ckpt_mu_)
+    std::thread checkpointer_;
+
+    // Último checkpoint completado (ver LastCheckpoint)
+    std::atomic<uint64_t> last_ckpt_duration_us_{0};
+    std::atomic<int64_t> last_ckpt_time_ms_{0};
+    std::atomic<uint64_t> checkpoints_{0};
+
+    // Llamar tras publicar una mutación y soltar los locks. INTERNAL si su
+    // registro no entró en el log o (en sync) no llegó a disco: la mutación
+    // ya es visible en memoria pero no sobrevivirá a un reinicio.
+    grpc::Status CommitMutation(uint64_t txid);
+    const char* CheckpointDue(uint64_t txid) const;
+    void CheckpointLoop();
+    bool RunCheckpoint(const char* trigger);  // false si falló (sin cambios cuenta como éxito)
     std::string MetaPath(const std::string& file) const;
 
     // --------- Utilidades de red para RegisterDataNode ---------
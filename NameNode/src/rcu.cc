@@ -0,0 +1,100 @@
+#include "rcu.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+namespace rcu {
+namespace {
+
+// Slot de un hilo lector. Los slots nunca se liberan: al terminar el hilo
+// se marcan libres y otro hilo los reutiliza (gRPC crea y destruye hilos).
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0};   // 0 = fuera de sección de lectura
+    std::atomic<bool> owned{false};
+    ReaderSlot* next = nullptr;
+};
+
+std::atomic<uint64_t> g_epoch{1};
+std::atomic<ReaderSlot*> g_slots{nullptr};
+
+ReaderSlot* AcquireSlot() {
+    for (ReaderSlot* s = g_slots.load(); s != nullptr; s = s->next) {
+        bool expected = false;
+        if (!s->owned.load(std::memory_order_relaxed) &&
+            s->owned.compare_exchange_strong(expected, true)) {
+            return s;
+        }
+    }
+    auto* s = new ReaderSlot();
+    s->owned.store(true);
+    ReaderSlot* head = g_slots.load();
+    do {
+        s->next = head;
+    } while (!g_slots.compare_exchange_weak(head, s));
+    return s;
+}
+
+// Un slot por hilo; se devuelve al registro cuando el hilo termina
+struct ThreadSlot {
+    ReaderSlot* slot = nullptr;
+    uint32_t depth = 0;
+    ~ThreadSlot() {
+        if (slot) {
+            slot->epoch.store(0);
+            slot->owned.store(false);
+        }
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+// Época mínima anunciada por lectores activos (UINT64_MAX si no hay ninguno)
+uint64_t MinActiveEpoch() {
+    uint64_t min_epoch = UINT64_MAX;
+    for (ReaderSlot* s = g_slots.load(); s != nullptr; s = s->next) {
+        uint64_t e = s->epoch.load();
+        if (e != 0 && e < min_epoch) min_epoch = e;
+    }
+    return min_epoch;
+}
+
+}  // namespace
+
+ReadGuard::ReadGuard() {
+    if (t_slot.depth++ > 0) return;  // guard anidado: ya anunciado
+    if (!t_slot.slot) t_slot.slot = AcquireSlot();
+    // seq_cst: el anuncio debe ser visible antes de cargar el puntero publicado
+    t_slot.slot->epoch.store(g_epoch.load());
+}
+
+ReadGuard::~ReadGuard() {
+    if (--t_slot.depth > 0) return;
+    t_slot.slot->epoch.store(0, std::memory_order_release);
+}
+
+RetireList::~RetireList() {
+    for (auto& r : list_) r.fn();
+}
+
+void RetireList::RetireFn(std::function<void()> fn) {
+    // Un lector que anuncie una época >= stamp ya ve la versión nueva
+    const uint64_t stamp = g_epoch.fetch_add(1) + 1;
+    list_.push_back({stamp, std::move(fn)});
+    if (list_.size() < scan_at_) return;
+
+    const uint64_t min_epoch = MinActiveEpoch();
+    size_t keep = 0;
+    for (size_t i = 0; i < list_.size(); ++i) {
+        if (list_[i].epoch <= min_epoch) {
+            list_[i].fn();
+        } else {
+            if (keep != i) list_[keep] = std::move(list_[i]);
+            ++keep;
+        }
+    }
+    list_.resize(keep);
+    scan_at_ = std::max(kMinScan, 2 * keep);
+}
+
+}  // namespace rcu
@@ -0,0 +1,69 @@
+#ifndef RCU_H
+#define RCU_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// ==============================
+// Reclamación diferida por épocas (estilo RCU)
+// ==============================
+//
+// Las estructuras inmutables se publican con un std::atomic<const T*>. Los
+// lectores abren un rcu::ReadGuard, cargan el puntero y lo usan sin tomar
+// ningún lock: el guard solo escribe la época actual en un slot propio del
+// hilo, así que no hay líneas de caché compartidas entre lectores.
+//
+// El escritor publica la nueva versión y entrega la anterior a la
+// RetireList de su dominio; se libera cuando ningún lector que pudiera
+// verla sigue activo.
+namespace rcu {
+
+class ReadGuard {
+public:
+    ReadGuard();
+    ~ReadGuard();
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+};
+
+// Objetos retirados por un dominio de escritores (una partición, la tabla
+// de usuarios, el registro de DataNodes). Quien la usa ya serializa a sus
+// escritores con su propio lock, así que retirar no toma ningún lock
+// compartido con otros dominios. Los slots de los lectores solo se
+// recorren cuando la lista dobla lo que quedó pendiente en el recorrido
+// anterior (coste amortizado constante por objeto).
+class RetireList {
+public:
+    RetireList() = default;
+    ~RetireList();  // libera todo: solo cuando ya no puede haber lectores
+    RetireList(const RetireList&) = delete;
+    RetireList& operator=(const RetireList&) = delete;
+
+    // Con el lock del dominio, después de publicar el reemplazo de 'fn'
+    // (orden seq_cst)
+    void RetireFn(std::function<void()> fn);
+
+    template <typename T>
+    void Retire(const T* p) {
+        if (p) RetireFn([p] { delete p; });
+    }
+
+    // Objetos retirados pendientes de liberar (diagnóstico; con el lock del dominio)
+    size_t Pending() const { return list_.size(); }
+
+private:
+    static constexpr size_t kMinScan = 8;
+
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> fn;
+    };
+    std::vector<Retired> list_;
+    size_t scan_at_ = kMinScan;
+};
+
+}  // namespace rcu
+
+#endif // RCU_H
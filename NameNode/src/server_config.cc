@@ -0,0 +1,220 @@
+#include "server_config.h"
+
+#include <grpcpp/resource_quota.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+enum class Kind { kString, kInt, kInt64, kBool };
+
+struct Field {
+    const char* key;
+    Kind kind;
+    void* ptr;
+    const char* help;
+};
+
+std::vector<Field> FieldsOf(ServerConfig* c) {
+    return {
+        {"listen_address", Kind::kString, &c->listen_address, "dirección host:puerto"},
+        {"control_address", Kind::kString, &c->control_address, "plano de control para DataNodes (vacío = desactivado)"},
+        {"control_threads", Kind::kInt, &c->control_threads, "hilos reservados del plano de control"},
+        {"server_mode", Kind::kString, &c->server_mode, "sync | async"},
+        {"cqs", Kind::kInt, &c->cqs, "async: completion queues"},
+        {"cq_threads", Kind::kInt, &c->cq_threads, "async: hilos por cola"},
+        {"cpu_pin", Kind::kBool, &c->cpu_pin, "async: fijar hilos a CPUs"},
+        {"sync_cqs", Kind::kInt, &c->sync_cqs, "sync: colas internas"},
+        {"min_pollers", Kind::kInt, &c->min_pollers, "sync: hilos de sondeo mínimos"},
+        {"max_pollers", Kind::kInt, &c->max_pollers, "sync: hilos de sondeo máximos"},
+        {"max_threads", Kind::kInt, &c->max_threads, "ResourceQuota: hilos máximos de gRPC"},
+        {"memory_quota_mb", Kind::kInt64, &c->memory_quota_mb, "ResourceQuota: memoria (MiB)"},
+        {"max_concurrent_streams", Kind::kInt, &c->max_concurrent_streams, "streams HTTP/2 por conexión"},
+        {"max_recv_msg_mb", Kind::kInt, &c->max_recv_msg_mb, "tamaño máximo de mensaje recibido (MiB)"},
+        {"max_send_msg_mb", Kind::kInt, &c->max_send_msg_mb, "tamaño máximo de mensaje enviado (MiB)"},
+        {"keepalive_time_ms", Kind::kInt, &c->keepalive_time_ms, "intervalo de pings keepalive"},
+        {"keepalive_timeout_ms", Kind::kInt, &c->keepalive_timeout_ms, "espera del ack de keepalive"},
+        {"keepalive_permit_without_calls", Kind::kBool, &c->keepalive_permit_without_calls, "keepalive sin RPCs activas"},
+        {"min_ping_interval_ms", Kind::kInt, &c->min_ping_interval_ms, "mínimo entre pings del cliente"},
+    };
+}
+
+std::string Trim(const std::string& s) {
+    size_t b = 0, e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) ++b;
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) --e;
+    return s.substr(b, e - b);
+}
+
+bool SetField(ServerConfig* c, const std::string& key, const std::string& value,
+              const std::string& origin, std::string* err) {
+    for (const Field& f : FieldsOf(c)) {
+        if (key != f.key) continue;
+        if (f.kind == Kind::kString) {
+            *static_cast<std::string*>(f.ptr) = value;
+            return true;
+        }
+        if (f.kind == Kind::kBool) {
+            if (value == "1" || value == "true") *static_cast<bool*>(f.ptr) = true;
+            else if (value == "0" || value == "false") *static_cast<bool*>(f.ptr) = false;
+            else break;
+            return true;
+        }
+        char* end = nullptr;
+        errno = 0;
+        long long v = std::strtoll(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || errno != 0 || v < 0) break;
+        if (f.kind == Kind::kInt) {
+            if (v > INT32_MAX) break;
+            *static_cast<int*>(f.ptr) = static_cast<int>(v);
+        } else {
+            *static_cast<int64_t*>(f.ptr) = v;
+        }
+        return true;
+    }
+    bool known = false;
+    for (const Field& f : FieldsOf(c)) known = known || key == f.key;
+    *err = origin + ": " + (known ? "valor inválido para " + key + ": '" + value + "'"
+                                  : "opción desconocida '" + key + "'");
+    return false;
+}
+
+bool LoadFile(ServerConfig* c, const std::string& path, std::string* err) {
+    std::ifstream in(path);
+    if (!in) {
+        *err = "no se pudo abrir " + path;
+        return false;
+    }
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        auto hash = line.find('#');
+        if (hash != std::string::npos) line.resize(hash);
+        line = Trim(line);
+        if (line.empty()) continue;
+        auto eq = line.find('=');
+        const std::string origin = path + ":" + std::to_string(lineno);
+        if (eq == std::string::npos) {
+            *err = origin + ": se esperaba clave = valor";
+            return false;
+        }
+        if (!SetField(c, Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)), origin, err)) return false;
+    }
+    return true;
+}
+
+std::string EnvName(const char* key) {
+    std::string name = "GRIDDFS_";
+    for (const char* p = key; *p; ++p) name += static_cast<char>(std::toupper(static_cast<unsigned char>(*p)));
+    return name;
+}
+
+// Los límites de mensaje de gRPC son int: se satura en INT_MAX
+int MiBToBytes(int mib) {
+    return static_cast<int>(std::min<int64_t>(static_cast<int64_t>(mib) * 1024 * 1024, INT32_MAX));
+}
+
+}  // namespace
+
+bool ServerConfig::Load(int argc, char** argv, std::string* err) {
+    // 1. archivo (--config tiene prioridad sobre GRIDDFS_CONFIG)
+    std::string config_path;
+    if (const char* p = std::getenv("GRIDDFS_CONFIG")) config_path = p;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--config=", 0) == 0) config_path = arg.substr(9);
+    }
+    if (!config_path.empty() && !LoadFile(this, config_path, err)) return false;
+
+    // 2. entorno
+    for (const Field& f : FieldsOf(this)) {
+        const std::string name = EnvName(f.key);
+        if (const char* v = std::getenv(name.c_str())) {
+            if (!SetField(this, f.key, v, name, err)) return false;
+        }
+    }
+
+    // 3. línea de comandos
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            help = true;
+            continue;
+        }
+        if (arg.rfind("--config=", 0) == 0) continue;
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            *err = "argumento inválido '" + arg + "' (se esperaba --clave=valor)";
+            return false;
+        }
+        if (!SetField(this, arg.substr(2, eq - 2), arg.substr(eq + 1), "línea de comandos", err)) return false;
+    }
+
+    if (server_mode != "sync" && server_mode != "async") {
+        *err = "server_mode debe ser sync o async";
+        return false;
+    }
+    if (min_pollers > 0 && max_pollers > 0 && min_pollers > max_pollers) {
+        *err = "min_pollers no puede superar max_pollers";
+        return false;
+    }
+    return true;
+}
+
+void ServerConfig::Apply(grpc::ServerBuilder& builder) const {
+    if (server_mode == "sync") {
+        if (sync_cqs > 0) builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::NUM_CQS, sync_cqs);
+        if (min_pollers > 0) builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MIN_POLLERS, min_pollers);
+        if (max_pollers > 0) builder.SetSyncServerOption(grpc::ServerBuilder::SyncServerOption::MAX_POLLERS, max_pollers);
+    }
+
+    if (max_threads > 0 || memory_quota_mb > 0) {
+        grpc::ResourceQuota quota("griddfs_namenode");
+        if (max_threads > 0) quota.SetMaxThreads(max_threads);
+        if (memory_quota_mb > 0) quota.Resize(static_cast<size_t>(memory_quota_mb) * 1024 * 1024);
+        builder.SetResourceQuota(quota);
+    }
+
+    if (max_concurrent_streams > 0) builder.AddChannelArgument(GRPC_ARG_MAX_CONCURRENT_STREAMS, max_concurrent_streams);
+    if (max_recv_msg_mb > 0) builder.SetMaxReceiveMessageSize(MiBToBytes(max_recv_msg_mb));
+    if (max_send_msg_mb > 0) builder.SetMaxSendMessageSize(MiBToBytes(max_send_msg_mb));
+
+    if (keepalive_time_ms > 0) builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIME_MS, keepalive_time_ms);
+    if (keepalive_timeout_ms > 0) builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, keepalive_timeout_ms);
+    if (keepalive_permit_without_calls) builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    if (min_ping_interval_ms > 0) {
+        builder.AddChannelArgument(GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, min_ping_interval_ms);
+    }
+}
+
+void ServerConfig::Print(std::ostream& os) const {
+    for (const Field& f : FieldsOf(const_cast<ServerConfig*>(this))) {
+        os << "[Config] " << f.key << "=";
+        switch (f.kind) {
+            case Kind::kString: os << *static_cast<const std::string*>(f.ptr); break;
+            case Kind::kInt: os << *static_cast<const int*>(f.ptr); break;
+            case Kind::kInt64: os << *static_cast<const int64_t*>(f.ptr); break;
+            case Kind::kBool: os << (*static_cast<const bool*>(f.ptr) ? "true" : "false"); break;
+        }
+        const bool unset = (f.kind == Kind::kInt && *static_cast<const int*>(f.ptr) == 0) ||
+                           (f.kind == Kind::kInt64 && *static_cast<const int64_t*>(f.ptr) == 0);
+        if (unset) os << " (defecto de gRPC)";
+        os << "\n";
+    }
+    os << std::flush;
+}
+
+void ServerConfig::PrintUsage(std::ostream& os) {
+    ServerConfig defaults;
+    os << "Uso: namenode [--config=<archivo>] [--clave=valor ...]\n"
+          "Cada clave también se lee de GRIDDFS_<CLAVE>; 0 = valor por defecto de gRPC.\n";
+    for (const Field& f : FieldsOf(&defaults)) {
+        os << "  --" << f.key << "  " << f.help << "\n";
+    }
+}
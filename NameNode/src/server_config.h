@@ -0,0 +1,68 @@
+#ifndef SERVER_CONFIG_H
+#define SERVER_CONFIG_H
+
+#include <grpcpp/grpcpp.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// ==============================
+// Configuración del servidor gRPC del NameNode
+// ==============================
+//
+// Cada opción tiene una clave (p. ej. max_threads) que se puede dar, de
+// menor a mayor prioridad, en:
+//   1. archivo de configuración (líneas "clave = valor", '#' comenta),
+//      indicado con --config=<ruta> o GRIDDFS_CONFIG
+//   2. variable de entorno GRIDDFS_<CLAVE EN MAYÚSCULAS>
+//   3. línea de comandos --clave=valor
+// En los límites numéricos, 0 significa "valor por defecto de gRPC".
+struct ServerConfig {
+    std::string listen_address = "0.0.0.0:50050";
+
+    // Plano de control: RPCs de DataNodes en un puerto y pool propios
+    // (vacío = desactivado; los DataNodes siguen pudiendo usar el principal)
+    std::string control_address = "0.0.0.0:50060";
+    int control_threads = 2;
+
+    // Modelo de servidor: sync (pool de gRPC) o async (async_server.h)
+    std::string server_mode = "sync";
+    int cqs = 2;                     // async: completion queues
+    int cq_threads = 2;              // async: hilos por cola
+    bool cpu_pin = false;            // async: fijar hilos a CPUs
+
+    // Servidor síncrono
+    int sync_cqs = 0;                // colas internas del pool
+    int min_pollers = 0;
+    int max_pollers = 0;
+
+    // ResourceQuota: tope de hilos y de memoria de gRPC
+    int max_threads = 256;
+    int64_t memory_quota_mb = 0;
+
+    // Canal HTTP/2 y mensajes
+    int max_concurrent_streams = 0;  // por conexión
+    int max_recv_msg_mb = 0;
+    int max_send_msg_mb = 0;
+
+    // Keepalive
+    int keepalive_time_ms = 0;
+    int keepalive_timeout_ms = 0;
+    bool keepalive_permit_without_calls = false;
+    int min_ping_interval_ms = 0;    // mínimo aceptado entre pings del cliente
+
+    // Lee archivo, entorno y argumentos en ese orden. false (con 'err')
+    // ante claves desconocidas o valores inválidos. --help deja help=true.
+    bool Load(int argc, char** argv, std::string* err);
+    bool help = false;
+
+    // Aplica los límites (no la dirección de escucha) al builder
+    void Apply(grpc::ServerBuilder& builder) const;
+
+    // Valores efectivos, una línea por opción
+    void Print(std::ostream& os) const;
+    static void PrintUsage(std::ostream& os);
+};
+
+#endif // SERVER_CONFIG_H
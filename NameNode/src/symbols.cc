@@ -0,0 +1,172 @@
+#include "symbols.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace symbols {
+namespace {
+
+// Las cadenas viven en bloques de kChunkSize que no se mueven nunca: str()
+// indexa sin locks y el índice de cada franja apunta a ellas.
+constexpr size_t kChunkBits = 12;
+constexpr size_t kChunkSize = size_t{1} << kChunkBits;
+constexpr size_t kMaxSymbols = size_t{1} << 28;
+constexpr size_t kMaxChunks = kMaxSymbols >> kChunkBits;
+constexpr size_t kStripes = 16;
+
+// Nodo de unordered_map<string_view, Symbol> más su puntero en la tabla de buckets
+constexpr size_t kIndexEntryBytes = sizeof(void*) + sizeof(std::string_view) + sizeof(size_t) + sizeof(void*);
+
+class Table {
+public:
+    Table() { Slot(0); }  // la cadena vacía
+
+    // Devuelve el símbolo con una referencia más
+    Symbol Intern(std::string_view s) {
+        if (s.empty()) return 0;
+        const size_t h = std::hash<std::string_view>{}(s);
+        // Franja por bits altos; los buckets de cada índice usan los bajos
+        const size_t si = (h >> 24) % kStripes;
+        Stripe& stripe = stripes_[si];
+        std::lock_guard<std::mutex> lock(stripe.mu);
+        auto it = stripe.index.find(s);
+        if (it != stripe.index.end()) {
+            Slot(it->second).refs.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+
+        const Symbol id = NewId();
+        Entry& e = Slot(id);
+        e.str.assign(s.data(), s.size());
+        e.refs.store(1, std::memory_order_relaxed);
+        e.stripe = static_cast<uint8_t>(si);
+        stripe.index.emplace(e.str, id);
+        bytes_.fetch_add(HeapBytes(e.str) + kIndexEntryBytes, std::memory_order_relaxed);
+        live_.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    // Solo con una referencia ya tomada: no puede llegar a cero a la vez
+    void AddRef(Symbol s) {
+        if (s != 0) Slot(s).refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Release(Symbol s) {
+        if (s == 0) return;
+        Entry& e = Slot(s);
+        // Mientras no sea la última, basta con restar
+        uint32_t n = e.refs.load(std::memory_order_relaxed);
+        while (n > 1) {
+            if (e.refs.compare_exchange_weak(n, n - 1, std::memory_order_acq_rel)) return;
+        }
+        // Posible última: con el lock de la franja, Intern() no puede
+        // resucitarla mientras sale del índice
+        Stripe& stripe = stripes_[e.stripe];
+        std::lock_guard<std::mutex> lock(stripe.mu);
+        if (e.refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        stripe.index.erase(e.str);
+        bytes_.fetch_sub(HeapBytes(e.str) + kIndexEntryBytes, std::memory_order_relaxed);
+        live_.fetch_sub(1, std::memory_order_relaxed);
+        std::string().swap(e.str);
+        std::lock_guard<std::mutex> free_lock(free_mu_);
+        free_.push_back(s);
+    }
+
+    const std::string& Str(Symbol s) const {
+        return chunks_[s >> kChunkBits].load(std::memory_order_acquire)[s & (kChunkSize - 1)].str;
+    }
+
+    Stats GetStats() const {
+        Stats st;
+        st.count = live_.load(std::memory_order_relaxed);
+        st.bytes = bytes_.load(std::memory_order_relaxed);
+        return st;
+    }
+
+private:
+    struct Entry {
+        std::string str;
+        std::atomic<uint32_t> refs{0};
+        uint8_t stripe = 0;  // franja cuyo índice la contiene
+    };
+
+    struct Stripe {
+        std::mutex mu;
+        std::unordered_map<std::string_view, Symbol> index;  // vistas de los bloques
+    };
+
+    static size_t HeapBytes(const std::string& s) {
+        return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+    }
+
+    // Con el lock de una franja (que se toma siempre antes que free_mu_)
+    Symbol NewId() {
+        {
+            std::lock_guard<std::mutex> lock(free_mu_);
+            if (!free_.empty()) {
+                const Symbol id = free_.back();
+                free_.pop_back();
+                return id;
+            }
+        }
+        const size_t id = next_.fetch_add(1, std::memory_order_relaxed);
+        if (id >= kMaxSymbols) throw std::length_error("symbols: tabla llena");
+        return static_cast<Symbol>(id);
+    }
+
+    Entry& Slot(size_t id) {
+        std::atomic<Entry*>& chunk = chunks_[id >> kChunkBits];
+        Entry* p = chunk.load(std::memory_order_acquire);
+        if (p == nullptr) {
+            // Dos franjas pueden estrenar el mismo bloque a la vez: gana una
+            auto fresh = std::make_unique<Entry[]>(kChunkSize);
+            if (chunk.compare_exchange_strong(p, fresh.get(), std::memory_order_acq_rel)) {
+                p = fresh.release();
+                bytes_.fetch_add(kChunkSize * sizeof(Entry), std::memory_order_relaxed);
+            }
+        }
+        return p[id & (kChunkSize - 1)];
+    }
+
+    std::atomic<Entry*> chunks_[kMaxChunks]{};  // nullptr: bloque sin estrenar
+    std::atomic<size_t> next_{1};
+    std::atomic<size_t> live_{0};
+    std::atomic<size_t> bytes_{0};
+    Stripe stripes_[kStripes];
+    std::mutex free_mu_;
+    std::vector<Symbol> free_;  // ids liberados, para reutilizar sus slots
+};
+
+Table& Instance() {
+    // No se destruye nunca: los metadatos que aún vivan al salir liberan sus
+    // Ref contra ella (y los bloques se usan hasta el final)
+    static Table* table = new Table();
+    return *table;
+}
+
+}  // namespace
+
+Ref::Ref(std::string_view s) : id_(Instance().Intern(s)) {}
+
+Ref::Ref(const Ref& other) : id_(other.id_) {
+    Instance().AddRef(id_);
+}
+
+Ref::~Ref() {
+    Instance().Release(id_);
+}
+
+const std::string& Ref::str() const {
+    return Instance().Str(id_);
+}
+
+Stats GetStats() {
+    return Instance().GetStats();
+}
+
+}  // namespace symbols
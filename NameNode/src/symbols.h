@@ -0,0 +1,61 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// ==============================
+// Tabla de cadenas internadas
+// ==============================
+//
+// Cadenas que se repiten en millones de metadatos (user_id, directorio de
+// cada archivo) se guardan una sola vez y los metadatos las referencian con
+// un Ref de 32 bits.
+//
+// Cada Ref cuenta como una referencia: cuando se destruye la última, la
+// cadena sale de la tabla y su slot se reutiliza: la tabla guarda solo las
+// cadenas vivas (también los block_id internados, que son únicos por
+// bloque) y los slots se quedan en el máximo que hubo a la vez. Copiar o destruir un Ref que no es el último no toma
+// locks; Intern() y la última liberación toman el lock de una de kStripes
+// franjas. str() no toma locks y vale mientras viva el Ref.
+namespace symbols {
+
+using Symbol = uint32_t;  // 0 es siempre la cadena vacía
+
+class Ref {
+public:
+    Ref() = default;
+    explicit Ref(std::string_view s);
+    Ref(const Ref& other);
+    Ref(Ref&& other) noexcept : id_(other.id_) { other.id_ = 0; }
+    Ref& operator=(Ref other) noexcept {
+        std::swap(id_, other.id_);
+        return *this;
+    }
+    ~Ref();
+
+    Symbol id() const { return id_; }
+    bool empty() const { return id_ == 0; }
+    const std::string& str() const;
+
+    bool operator==(const Ref& other) const { return id_ == other.id_; }
+    bool operator!=(const Ref& other) const { return id_ != other.id_; }
+
+private:
+    Symbol id_ = 0;
+};
+
+inline Ref Intern(std::string_view s) { return Ref(s); }
+
+struct Stats {
+    size_t count = 0;  // cadenas vivas (sin contar la vacía)
+    size_t bytes = 0;  // memoria aproximada de la tabla (cadenas + índice)
+};
+Stats GetStats();
+
+}  // namespace symbols
+
+#endif // SYMBOLS_H
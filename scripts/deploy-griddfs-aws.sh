@@ -205,6 +205,10 @@ else
     --group-name "$SECURITY_GROUP" \
     --protocol tcp --port 50051 --source-group "$SECURITY_GROUP"
   
+  aws ec2 authorize-security-group-ingress \
+    --group-name "$SECURITY_GROUP" \
+    --protocol tcp --port 50060 --source-group "$SECURITY_GROUP"
+  
   # Agregar reglas de acceso externo
   aws ec2 authorize-security-group-ingress \
     --group-name "$SECURITY_GROUP" \
@@ -49,8 +49,9 @@ if [ -z "$NAMENODE_HOST" ]; then
     read -r NAMENODE_HOST
 fi
 
+# Puerto del plano de control del NameNode (RPCs de DataNodes); 50050 también las acepta
 if [ -z "$NAMENODE_PORT" ]; then
-    NAMENODE_PORT="50050"
+    NAMENODE_PORT="50060"
 fi
 
 DATANODE_ID=${DATANODE_ID:-"datanode-$(hostname)"}